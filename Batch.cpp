@@ -0,0 +1,498 @@
+// Batch solver: solves many TSPLIB instances in one process. A loader thread reads
+// instances ahead of the solvers, a fixed set of solver threads takes them in order,
+// and every result is written as soon as its instance is solved, so the output is in
+// completion order. Rows carry the instance's position in the input for sorting.
+//
+//   tsm_batch (DIRECTORY | --manifest FILE) [--format csv|json] [--output FILE]
+//             [--jobs N] [--prefetch N] [--mode MODE] [--curve hilbert|moore]
+//             [--improvement none|2-opt|lin-kernighan|parallel-2-opt] [--budget SECONDS]
+//             [--no-tours]
+//
+// MODE is one of polar-sort, elastic-net, space-filling-curve, greedy-edge,
+// nearest-neighbour, farthest-insertion, cheapest-insertion or christofides.
+//
+// A directory is searched for *.tsp files, a manifest lists one path per line, relative
+// to the manifest, with # starting a comment. json writes one object per line.
+
+#include "Instance.h"
+#include "Net.h"
+#include "RingNetIndex.h"
+#include "Solver.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include "Tsplib.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// Instances are solved in the viewer's coordinates like in tsm_bench, lengths are
+// measured on the original coordinates
+const double WIDTH = 1200.0;
+const double HEIGHT = 800.0;
+const int NET_RINGS = 30;
+
+enum class Format { Csv, Json };
+
+struct Settings {
+    std::vector<std::string> paths;
+    Format format = Format::Csv;
+    std::string outputPath;
+    // Solver threads, 0 uses one per shared pool thread
+    unsigned jobs = 0;
+    // Loaded instances waiting for a solver, 0 uses two per solver thread
+    std::size_t prefetch = 0;
+    SolverOptions solver;
+    bool tours = true;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool listDirectory(const char* directory, std::vector<std::string>& paths) {
+    std::error_code error;
+    std::filesystem::directory_iterator it(directory, error);
+    if (error) {
+        std::cerr << "Cannot read directory " << directory << ": " << error.message() << std::endl;
+        return false;
+    }
+    for (const std::filesystem::directory_entry& entry : it) {
+        if (entry.is_regular_file() && entry.path().extension() == ".tsp") {
+            paths.push_back(entry.path().string());
+        }
+    }
+    // Directory order is arbitrary, keep runs comparable
+    std::sort(paths.begin(), paths.end());
+    return true;
+}
+
+bool readManifest(const char* manifest, std::vector<std::string>& paths) {
+    std::ifstream in(manifest);
+    if (!in) {
+        std::cerr << "Cannot open manifest " << manifest << std::endl;
+        return false;
+    }
+    const std::filesystem::path base = std::filesystem::path(manifest).parent_path();
+    std::string line;
+    while (std::getline(in, line)) {
+        line.erase(std::find(line.begin(), line.end(), '#'), line.end());
+        const std::size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            continue;
+        }
+        const std::size_t last = line.find_last_not_of(" \t\r");
+        std::filesystem::path path = line.substr(first, last - first + 1);
+        paths.push_back(path.is_relative() ? (base / path).string() : path.string());
+    }
+    return true;
+}
+
+bool parseMode(const char* value, SolverMode& mode) {
+    for (SolverMode candidate : solverModes()) {
+        if (std::strcmp(value, solverModeName(candidate)) == 0) {
+            mode = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseCurve(const char* value, CurveType& curve) {
+    for (CurveType candidate : {CurveType::Hilbert, CurveType::Moore}) {
+        if (std::strcmp(value, curveTypeName(candidate)) == 0) {
+            curve = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseImprovement(const char* value, Improvement& improvement) {
+    for (Improvement candidate :
+         {Improvement::None, Improvement::TwoOpt, Improvement::LinKernighan, Improvement::ParallelTwoOpt}) {
+        if (std::strcmp(value, improvementName(candidate)) == 0) {
+            improvement = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool parseSettings(int argc, char* argv[], Settings& settings) {
+    bool haveInput = false;
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        if (std::strncmp(option, "--", 2) != 0) {
+            if (haveInput) {
+                std::cerr << "Only one directory or manifest can be given" << std::endl;
+                return false;
+            }
+            haveInput = true;
+            if (!listDirectory(option, settings.paths)) {
+                return false;
+            }
+            continue;
+        }
+        if (std::strcmp(option, "--no-tours") == 0) {
+            settings.tours = false;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(option, "--manifest") == 0) {
+            if (haveInput) {
+                std::cerr << "Only one directory or manifest can be given" << std::endl;
+                return false;
+            }
+            haveInput = true;
+            if (!readManifest(value, settings.paths)) {
+                return false;
+            }
+        } else if (std::strcmp(option, "--format") == 0) {
+            if (std::strcmp(value, "csv") == 0) {
+                settings.format = Format::Csv;
+            } else if (std::strcmp(value, "json") == 0) {
+                settings.format = Format::Json;
+            } else {
+                std::cerr << "Unknown format " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(option, "--output") == 0) {
+            settings.outputPath = value;
+        } else if (std::strcmp(option, "--jobs") == 0) {
+            settings.jobs = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(option, "--prefetch") == 0) {
+            settings.prefetch = static_cast<std::size_t>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(option, "--mode") == 0) {
+            if (!parseMode(value, settings.solver.mode)) {
+                std::cerr << "Unknown mode " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(option, "--curve") == 0) {
+            if (!parseCurve(value, settings.solver.curve)) {
+                std::cerr << "Unknown curve " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(option, "--improvement") == 0) {
+            if (!parseImprovement(value, settings.solver.improvement)) {
+                std::cerr << "Unknown improvement " << value << std::endl;
+                return false;
+            }
+        } else if (std::strcmp(option, "--budget") == 0) {
+            settings.solver.timeLimitSeconds = std::strtod(value, nullptr);
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+    if (!haveInput) {
+        std::cerr << "Usage: tsm_batch (DIRECTORY | --manifest FILE) [--format csv|json] [--output FILE] "
+                     "[--jobs N] [--prefetch N] [--mode MODE] [--curve hilbert|moore] "
+                     "[--improvement none|2-opt|lin-kernighan|parallel-2-opt] [--budget SECONDS] [--no-tours]"
+                  << std::endl;
+        std::cerr << "Modes:";
+        for (SolverMode mode : solverModes()) {
+            std::cerr << " " << solverModeName(mode);
+        }
+        std::cerr << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// An instance on its way from the loader to a solver
+struct Job {
+    std::size_t index;
+    std::string path;
+    TsplibInstance instance;
+    bool loaded = false;
+    double loadSeconds = 0.0;
+};
+
+// Bounded queue between the loader and the solvers. push blocks while it is full, pop
+// while it is empty, and pop returns null once it is closed and drained.
+class JobQueue {
+public:
+    explicit JobQueue(std::size_t capacity) : capacity(std::max<std::size_t>(capacity, 1)) {}
+
+    void push(std::unique_ptr<Job> job) {
+        std::unique_lock<std::mutex> lock(mutex);
+        notFull.wait(lock, [this] { return jobs.size() < capacity; });
+        jobs.push_back(std::move(job));
+        notEmpty.notify_one();
+    }
+
+    std::unique_ptr<Job> pop() {
+        std::unique_lock<std::mutex> lock(mutex);
+        notEmpty.wait(lock, [this] { return closed || !jobs.empty(); });
+        if (jobs.empty()) {
+            return nullptr;
+        }
+        std::unique_ptr<Job> job = std::move(jobs.front());
+        jobs.pop_front();
+        notFull.notify_one();
+        return job;
+    }
+
+    // No more pushes, wakes every waiting solver
+    void close() {
+        std::lock_guard<std::mutex> lock(mutex);
+        closed = true;
+        notEmpty.notify_all();
+    }
+
+private:
+    const std::size_t capacity;
+    std::mutex mutex;
+    std::condition_variable notFull;
+    std::condition_variable notEmpty;
+    std::deque<std::unique_ptr<Job>> jobs;
+    bool closed = false;
+};
+
+struct Result {
+    std::size_t index;
+    const std::string* path;
+    std::string name;
+    bool ok = false;
+    std::size_t n = 0;
+    long long length = 0;
+    double loadSeconds = 0.0;
+    double solveSeconds = 0.0;
+    Tour tour;
+};
+
+void writeCsvField(std::string& out, const std::string& text) {
+    if (text.find_first_of(",\"\n\r") == std::string::npos) {
+        out += text;
+        return;
+    }
+    out += '"';
+    for (char c : text) {
+        if (c == '"') {
+            out += '"';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+void writeJsonString(std::string& out, const std::string& text) {
+    out += '"';
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += c;
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", static_cast<unsigned>(c));
+            out += escaped;
+        } else {
+            out += c;
+        }
+    }
+    out += '"';
+}
+
+// Formats results and writes each as one line under a lock, flushed right away so the
+// output can be followed while the batch runs
+class ResultWriter {
+public:
+    ResultWriter(std::FILE* out, Format format, bool tours) : out(out), format(format), tours(tours) {
+        if (format == Format::Csv) {
+            std::fprintf(out, "index,instance,path,status,n,length,load_seconds,solve_seconds%s\n",
+                         tours ? ",tour" : "");
+            std::fflush(out);
+        }
+    }
+
+    void write(const Result& result) {
+        // Formatting needs no lock, only the write does
+        std::string line;
+        char number[64];
+        if (format == Format::Csv) {
+            std::snprintf(number, sizeof(number), "%zu,", result.index);
+            line += number;
+            writeCsvField(line, result.name);
+            line += ',';
+            writeCsvField(line, *result.path);
+            std::snprintf(number, sizeof(number), ",%s,%zu,%lld,%.6f,%.6f", result.ok ? "ok" : "error", result.n,
+                          result.length, result.loadSeconds, result.solveSeconds);
+            line += number;
+            if (tours) {
+                // TSPLIB node numbers, space separated
+                line += ',';
+                for (std::size_t i = 0; i < result.tour.size(); ++i) {
+                    std::snprintf(number, sizeof(number), i == 0 ? "%u" : " %u", result.tour[i] + 1);
+                    line += number;
+                }
+            }
+        } else {
+            std::snprintf(number, sizeof(number), "{\"index\": %zu, \"instance\": ", result.index);
+            line += number;
+            writeJsonString(line, result.name);
+            line += ", \"path\": ";
+            writeJsonString(line, *result.path);
+            std::snprintf(number, sizeof(number), ", \"status\": \"%s\", \"n\": %zu, \"length\": %lld",
+                          result.ok ? "ok" : "error", result.n, result.length);
+            line += number;
+            std::snprintf(number, sizeof(number), ", \"load_seconds\": %.6f, \"solve_seconds\": %.6f",
+                          result.loadSeconds, result.solveSeconds);
+            line += number;
+            if (tours) {
+                line += ", \"tour\": [";
+                for (std::size_t i = 0; i < result.tour.size(); ++i) {
+                    std::snprintf(number, sizeof(number), i == 0 ? "%u" : ", %u", result.tour[i] + 1);
+                    line += number;
+                }
+                line += ']';
+            }
+            line += '}';
+        }
+        line += '\n';
+
+        std::lock_guard<std::mutex> lock(mutex);
+        std::fwrite(line.data(), 1, line.size(), out);
+        std::fflush(out);
+    }
+
+private:
+    std::FILE* out;
+    const Format format;
+    const bool tours;
+    std::mutex mutex;
+};
+
+// Exceptions, such as running out of memory on a huge instance, fail just this job
+// instead of escaping its thread
+void load(Job& job) {
+    auto start = std::chrono::steady_clock::now();
+    try {
+        job.loaded = loadTsplib(job.path.c_str(), job.instance);
+    } catch (const std::exception& exception) {
+        std::cerr << job.path << ": loading failed: " << exception.what() << std::endl;
+        job.loaded = false;
+        job.instance = TsplibInstance();
+    }
+    job.loadSeconds = secondsSince(start);
+}
+
+bool solve(const Settings& settings, const Job& job, Result& result) {
+    TSM_TRACE_SCOPE("solveInstance");
+    auto start = std::chrono::steady_clock::now();
+    try {
+        PointStore cities = job.instance.cities;
+        fitToArea(cities, WIDTH, HEIGHT);
+        PointStore net = createNet(cities, NET_RINGS);
+        RingNetIndex netIndex(net);
+        result.tour = solveTour(cities, net, netIndex, settings.solver);
+        result.length = tsplibTourLength(job.instance, result.tour);
+    } catch (const std::exception& exception) {
+        std::cerr << job.path << ": solving failed: " << exception.what() << std::endl;
+        result.tour = Tour();
+        result.length = 0;
+        result.solveSeconds = secondsSince(start);
+        return false;
+    }
+    result.solveSeconds = secondsSince(start);
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (!parseSettings(argc, argv, settings)) {
+        return 1;
+    }
+
+    std::FILE* out = stdout;
+    if (!settings.outputPath.empty()) {
+        out = std::fopen(settings.outputPath.c_str(), "w");
+        if (out == nullptr) {
+            std::cerr << "Cannot write " << settings.outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    setTraceThreadName("main");
+    auto start = std::chrono::steady_clock::now();
+    const unsigned jobs = settings.jobs > 0 ? settings.jobs : ThreadPool::shared().size();
+    JobQueue queue(settings.prefetch > 0 ? settings.prefetch : std::size_t{jobs} * 2);
+    ResultWriter writer(out, settings.format, settings.tours);
+
+    // Reads instances in input order while the solvers are busy, waiting whenever
+    // the queue is full so memory stays bounded
+    std::thread loader([&] {
+        setTraceThreadName("loader");
+        for (std::size_t index = 0; index < settings.paths.size(); ++index) {
+            auto job = std::make_unique<Job>();
+            job->index = index;
+            job->path = settings.paths[index];
+            load(*job);
+            queue.push(std::move(job));
+        }
+        queue.close();
+    });
+
+    // Instances run one per solver thread, their parallel phases share the pool
+    std::mutex countMutex;
+    std::size_t solved = 0;
+    std::size_t failed = 0;
+    std::vector<std::thread> solvers;
+    for (unsigned i = 0; i < jobs; ++i) {
+        solvers.emplace_back([&, i] {
+            std::string name = "solver " + std::to_string(i + 1);
+            setTraceThreadName(name.c_str());
+            while (std::unique_ptr<Job> job = queue.pop()) {
+                Result result;
+                result.index = job->index;
+                result.path = &settings.paths[job->index];
+                result.name = job->instance.name;
+                result.loadSeconds = job->loadSeconds;
+                result.ok = job->loaded;
+                if (job->loaded) {
+                    result.n = job->instance.cities.size();
+                    result.ok = solve(settings, *job, result);
+                }
+                writer.write(result);
+
+                std::lock_guard<std::mutex> lock(countMutex);
+                ++(result.ok ? solved : failed);
+            }
+        });
+    }
+
+    loader.join();
+    for (std::thread& solver : solvers) {
+        solver.join();
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    std::cerr << "Solved " << solved << " instances, " << failed << " failed, in " << secondsSince(start)
+              << " s on " << jobs << " solver threads" << std::endl;
+    if (const char* tracePath = std::getenv("TSM_TRACE")) {
+        writeChromeTrace(tracePath);
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,436 @@
+// End-to-end benchmark: times every stage of the pipeline, from instance creation over
+// the net and the nearest-point mapping to each tour improvement, for a range of
+// instance sizes or one TSPLIB instance. Results are written to stdout as JSON. The
+// render_bands stage also checks that the image does not depend on the band split, the
+// exit code is 1 if it does.
+//
+//   tsm_bench [--sizes 100,1000,...] [--seed N] [--time-limit SECONDS] [--budget SECONDS]
+//             [--instance FILE.tsp [--optimum LENGTH]] [--skip STAGE,...] [--trace FILE.json]
+//             [--image FILE.png|FILE.ppm] [--quadratic-limit N]
+
+#include "DistanceKernels.h"
+#include "ElasticNet.h"
+#include "ImageRenderer.h"
+#include "Instance.h"
+#include "KdTree.h"
+#include "LinKernighan.h"
+#include "Net.h"
+#include "ParallelTwoOpt.h"
+#include "RingNetIndex.h"
+#include "Solver.h"
+#include "SpaceFillingCurve.h"
+#include "Tour.h"
+#include "Trace.h"
+#include "Tsplib.h"
+#include "TwoOpt.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+
+namespace {
+
+const double WIDTH = 1200.0;
+const double HEIGHT = 800.0;
+const int NET_RINGS = 30;
+// Cheap stages are repeated until they took at least this long
+const double MIN_SAMPLE_SECONDS = 0.2;
+
+struct Settings {
+    std::vector<std::size_t> sizes = {100, 1000, 10000, 100000, 1000000};
+    unsigned seed = 1;
+    double timeLimitSeconds = 60.0;
+    // Wall-clock budget of the anytime solve
+    double budgetSeconds = 1.0;
+    // Largest instance the O(n^2) constructions run on
+    std::size_t quadraticLimit = 20000;
+    std::string instancePath;
+    double optimum = 0.0;
+    std::vector<std::string> skipped;
+    // Chrome trace of the run's phases, needs a build with TSM_TRACING
+    std::string tracePath;
+    // Picture of the last run's improved tour
+    std::string imagePath;
+};
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Same size and pixels
+bool sameImage(const Image& a, const Image& b) {
+    if (a.getWidth() != b.getWidth() || a.getHeight() != b.getHeight()) {
+        return false;
+    }
+    const std::size_t stride = static_cast<std::size_t>(a.getWidth()) * sizeof(Rgba);
+    for (int y = 0; y < a.getHeight(); ++y) {
+        if (std::memcmp(a.row(y), b.row(y), stride) != 0) {
+            return false;
+        }
+    }
+    return true;
+}
+
+long peakRssKilobytes() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    // Reported in bytes on macOS, kilobytes elsewhere
+    return static_cast<long>(usage.ru_maxrss / 1024);
+#else
+    return static_cast<long>(usage.ru_maxrss);
+#endif
+}
+
+std::vector<std::string> splitList(const char* text) {
+    std::vector<std::string> items;
+    std::string item;
+    for (const char* c = text; ; ++c) {
+        if (*c == ',' || *c == '\0') {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+            item.clear();
+            if (*c == '\0') {
+                break;
+            }
+        } else {
+            item += *c;
+        }
+    }
+    return items;
+}
+
+bool parseSettings(int argc, char* argv[], Settings& settings) {
+    for (int i = 1; i < argc; ++i) {
+        const char* option = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << option << std::endl;
+            return false;
+        }
+        const char* value = argv[++i];
+        if (std::strcmp(option, "--sizes") == 0) {
+            settings.sizes.clear();
+            for (const std::string& size : splitList(value)) {
+                settings.sizes.push_back(static_cast<std::size_t>(std::strtod(size.c_str(), nullptr)));
+            }
+        } else if (std::strcmp(option, "--seed") == 0) {
+            settings.seed = static_cast<unsigned>(std::strtoul(value, nullptr, 10));
+        } else if (std::strcmp(option, "--time-limit") == 0) {
+            settings.timeLimitSeconds = std::strtod(value, nullptr);
+        } else if (std::strcmp(option, "--budget") == 0) {
+            settings.budgetSeconds = std::strtod(value, nullptr);
+        } else if (std::strcmp(option, "--instance") == 0) {
+            settings.instancePath = value;
+        } else if (std::strcmp(option, "--optimum") == 0) {
+            settings.optimum = std::strtod(value, nullptr);
+        } else if (std::strcmp(option, "--skip") == 0) {
+            settings.skipped = splitList(value);
+        } else if (std::strcmp(option, "--trace") == 0) {
+            settings.tracePath = value;
+        } else if (std::strcmp(option, "--image") == 0) {
+            settings.imagePath = value;
+        } else if (std::strcmp(option, "--quadratic-limit") == 0) {
+            settings.quadraticLimit = static_cast<std::size_t>(std::strtod(value, nullptr));
+        } else {
+            std::cerr << "Unknown option " << option << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Prints text as a quoted JSON string. TSPLIB names are free text.
+void printJsonString(const std::string& text) {
+    std::putchar('"');
+    for (char c : text) {
+        if (c == '"' || c == '\\') {
+            std::printf("\\%c", c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            std::printf("\\u%04x", static_cast<unsigned>(c));
+        } else {
+            std::putchar(c);
+        }
+    }
+    std::putchar('"');
+}
+
+// Writes one run's stages as a JSON array
+class Report {
+public:
+    Report(const Settings& settings, const TsplibInstance* instance) : settings(settings), instance(instance) {}
+
+    bool enabled(const char* stage) const {
+        for (const std::string& skipped : settings.skipped) {
+            if (skipped == stage) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Time fn, repeating it while that is cheap, and record the average per call
+    template <typename Function>
+    void timed(const char* stage, std::size_t operations, Function fn) {
+        if (!enabled(stage)) {
+            return;
+        }
+        std::size_t repetitions = 0;
+        auto start = std::chrono::steady_clock::now();
+        double seconds;
+        do {
+            fn();
+            ++repetitions;
+            seconds = secondsSince(start);
+        } while (seconds < MIN_SAMPLE_SECONDS);
+        record(stage, operations, seconds / repetitions, repetitions, nullptr, nullptr);
+    }
+
+    // Record a stage that ran once
+    void once(const char* stage, std::size_t operations, double seconds) {
+        record(stage, operations, seconds, 1, nullptr, nullptr);
+    }
+
+    // Record a stage that produced a tour
+    void tour(const char* stage, std::size_t operations, double seconds, const PointStore& cities,
+              const Tour& tour, std::size_t moves = 0) {
+        record(stage, operations, seconds, 1, &cities, &tour, moves);
+    }
+
+    void finish() { std::printf("\n      ]"); }
+
+private:
+    void record(const char* stage, std::size_t operations, double seconds, std::size_t repetitions,
+                const PointStore* cities, const Tour* tour, std::size_t moves = 0) {
+        double ns = operations > 0 ? seconds * 1e9 / static_cast<double>(operations) : 0.0;
+        double throughput = seconds > 0.0 ? static_cast<double>(operations) / seconds : 0.0;
+        std::printf("%s\n        {\"stage\": \"%s\", \"operations\": %zu, \"repetitions\": %zu, "
+                    "\"seconds\": %.9g, \"ns_per_op\": %.6g, \"ops_per_second\": %.6g, \"peak_rss_kb\": %ld",
+                    first ? "" : ",", stage, operations, repetitions, seconds, ns, throughput, peakRssKilobytes());
+        if (tour != nullptr) {
+            std::printf(", \"tour_length\": %.10g, \"moves\": %zu", tourLength(*cities, *tour), moves);
+            if (instance != nullptr) {
+                long long length = tsplibTourLength(*instance, *tour);
+                std::printf(", \"tsplib_length\": %lld", length);
+                if (settings.optimum > 0.0) {
+                    std::printf(", \"optimum\": %.10g, \"gap_percent\": %.6g", settings.optimum,
+                                100.0 * (static_cast<double>(length) / settings.optimum - 1.0));
+                }
+            }
+        }
+        std::printf("}");
+        std::fflush(stdout);
+        first = false;
+    }
+
+    const Settings& settings;
+    const TsplibInstance* instance;
+    bool first = true;
+};
+
+// Runs and records every stage not skipped. False if a consistency check failed.
+bool runPipeline(const Settings& settings, PointStore& cities, Report& report) {
+    const std::size_t n = cities.size();
+    bool consistent = true;
+
+    PointStore net;
+    report.timed("create_net", n, [&] { net = createNet(cities, NET_RINGS); });
+    if (net.empty()) {
+        net = createNet(cities, NET_RINGS);
+    }
+    Vector<2> center = calculateCenter(cities);
+    report.timed("create_net_points", net.size(), [&] { createNetPoints(center, NET_RINGS); });
+
+    RingNetIndex netIndex;
+    report.timed("ring_index_build", net.size(), [&] { netIndex.build(net); });
+    if (netIndex.size() == 0) {
+        netIndex.build(net);
+    }
+
+    std::vector<PointId> closest;
+    report.timed("nearest_ring_index", n, [&] { closest = netIndex.nearestAll(cities); });
+    KdTree netTree(net);
+    report.timed("nearest_kdtree", n, [&] { netTree.nearestAll(cities); });
+    if (closest.size() != n) {
+        closest = netIndex.nearestAll(cities);
+    }
+    report.timed("angle_sort", n, [&] { sortByAngle(cities, net, closest); });
+
+    auto start = std::chrono::steady_clock::now();
+    Tour tour = buildPolarTour(cities, net, netIndex);
+    report.tour("polar_tour", n, secondsSince(start), cities, tour);
+
+    for (CurveType curve : {CurveType::Hilbert, CurveType::Moore}) {
+        std::string stage = std::string(curveTypeName(curve)) + "_tour";
+        if (report.enabled(stage.c_str())) {
+            start = std::chrono::steady_clock::now();
+            Tour curveTour = buildCurveTour(cities, curve);
+            report.tour(stage.c_str(), n, secondsSince(start), cities, curveTour);
+        }
+    }
+
+    // The other constructions through the solver's strategy switch, stage names
+    // being their mode names with underscores
+    for (SolverMode mode : solverModes()) {
+        if (mode == SolverMode::PolarSort || mode == SolverMode::ElasticNet || mode == SolverMode::SpaceFillingCurve) {
+            continue; // Timed under their own stages
+        }
+        const bool quadratic = solverModeIsQuadratic(mode);
+        std::string stage = std::string(solverModeName(mode)) + "_tour";
+        std::replace(stage.begin(), stage.end(), '-', '_');
+        if (report.enabled(stage.c_str()) && (!quadratic || n <= settings.quadraticLimit)) {
+            SolverOptions options;
+            options.mode = mode;
+            start = std::chrono::steady_clock::now();
+            Tour constructed = constructTour(cities, net, netIndex, options);
+            report.tour(stage.c_str(), n, secondsSince(start), cities, constructed);
+        }
+    }
+
+    NeighbourLists neighbours;
+    if (report.enabled("two_opt") || report.enabled("lin_kernighan") || report.enabled("parallel_two_opt")) {
+        start = std::chrono::steady_clock::now();
+        neighbours.build(cities, TwoOptOptions().neighbours);
+        report.once("neighbour_lists", n, secondsSince(start));
+    }
+
+    if (report.enabled("parallel_two_opt")) {
+        // From the polar tour too, on a copy so the sequential passes below start the same
+        Tour parallelTour = tour;
+        ParallelTwoOptOptions options;
+        options.timeLimitSeconds = settings.timeLimitSeconds;
+        ImprovementReport improvement = improveParallelTwoOpt(cities, parallelTour, neighbours, options);
+        report.tour("parallel_two_opt", n, improvement.seconds, cities, parallelTour, improvement.moves);
+    }
+
+    if (report.enabled("two_opt")) {
+        TwoOptOptions options;
+        options.timeLimitSeconds = settings.timeLimitSeconds;
+        ImprovementReport improvement = improveTwoOpt(cities, tour, neighbours, options);
+        report.tour("two_opt", n, improvement.seconds, cities, tour, improvement.moves);
+    }
+
+    if (report.enabled("lin_kernighan")) {
+        LinKernighanOptions options;
+        options.timeLimitSeconds = settings.timeLimitSeconds;
+        ImprovementReport improvement = improveLinKernighan(cities, tour, options);
+        report.tour("lin_kernighan", n, improvement.seconds, cities, tour, improvement.moves);
+    }
+
+    if (report.enabled("render_image")) {
+        start = std::chrono::steady_clock::now();
+        Image image = renderImage(static_cast<int>(WIDTH), static_cast<int>(HEIGHT), cities, net, tour);
+        report.once("render_image", n, secondsSince(start));
+        if (!settings.imagePath.empty()) {
+            writeImage(settings.imagePath.c_str(), image);
+        }
+
+        // Band counts of other thread counts, and odd ones, must give the same pixels
+        if (report.enabled("render_bands")) {
+            const std::size_t bandCounts[] = {1, 3, 8, 33};
+            start = std::chrono::steady_clock::now();
+            for (std::size_t bands : bandCounts) {
+                Image banded = renderImage(static_cast<int>(WIDTH), static_cast<int>(HEIGHT), cities, net, tour,
+                                           RenderStyle(), bands);
+                if (!sameImage(image, banded)) {
+                    std::cerr << "render_bands: " << bands << " bands differ from the default split" << std::endl;
+                    consistent = false;
+                }
+            }
+            report.once("render_bands", n, secondsSince(start) / std::size(bandCounts));
+        }
+    }
+
+    if (report.enabled("elastic_net")) {
+        ElasticNetOptions options;
+        options.timeLimitSeconds = settings.timeLimitSeconds;
+        ElasticNetResult result = solveElasticNet(cities, options);
+        report.tour("elastic_net", n, result.seconds, cities, result.tour, static_cast<std::size_t>(result.iterations));
+    }
+
+    if (report.enabled("anytime")) {
+        // The whole pipeline under one budget: when the first tour arrives and how good
+        // the last one is. moves counts the reported tours.
+        SolverOptions options;
+        options.improvement = Improvement::LinKernighan;
+        options.timeLimitSeconds = settings.budgetSeconds;
+        Tour first;
+        double firstSeconds = 0.0;
+        std::size_t reported = 0;
+        options.progress = [&](const SolverProgress& progress) {
+            if (reported++ == 0) {
+                first = progress.tour;
+                firstSeconds = progress.seconds;
+            }
+        };
+        start = std::chrono::steady_clock::now();
+        Tour best = solveTour(cities, net, netIndex, options);
+        double seconds = secondsSince(start);
+        report.tour("anytime_first", n, firstSeconds, cities, first);
+        report.tour("anytime", n, seconds, cities, best, reported);
+    }
+    return consistent;
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    Settings settings;
+    if (!parseSettings(argc, argv, settings)) {
+        return 1;
+    }
+
+    setTraceThreadName("main");
+    TsplibInstance instance;
+    bool consistent = true;
+    if (!settings.instancePath.empty() && !loadTsplib(settings.instancePath.c_str(), instance)) {
+        return 1;
+    }
+
+    std::printf("{\n  \"benchmark\": \"tsm_bench\",\n  \"simd\": \"%s\",\n  \"seed\": %u,\n"
+                "  \"time_limit_seconds\": %g,\n  \"runs\": [",
+                simdLevelName(detectSimdLevel()), settings.seed, settings.timeLimitSeconds);
+
+    if (!settings.instancePath.empty()) {
+        std::printf("\n    {\"instance\": ");
+        printJsonString(instance.name);
+        std::printf(", \"edge_weight_type\": \"%s\", \"n\": %zu, \"stages\": [",
+                    edgeWeightTypeName(instance.edgeWeightType), instance.cities.size());
+        Report report(settings, &instance);
+        // Solve in screen-sized coordinates like the viewer, lengths are measured on the original
+        PointStore cities = instance.cities;
+        fitToArea(cities, WIDTH, HEIGHT);
+        consistent = runPipeline(settings, cities, report) && consistent;
+        report.finish();
+        std::printf("}");
+    } else {
+        bool firstRun = true;
+        for (std::size_t size : settings.sizes) {
+            std::printf("%s\n    {\"instance\": \"random\", \"n\": %zu, \"stages\": [", firstRun ? "" : ",", size);
+            firstRun = false;
+            Report report(settings, nullptr);
+            PointStore cities;
+            report.timed("create_points", size, [&] {
+                cities = createPoints(static_cast<int>(size), WIDTH, HEIGHT, settings.seed);
+            });
+            if (cities.size() != size) {
+                cities = createPoints(static_cast<int>(size), WIDTH, HEIGHT, settings.seed);
+            }
+            consistent = runPipeline(settings, cities, report) && consistent;
+            report.finish();
+            std::printf("}");
+        }
+    }
+
+    std::printf("\n  ]\n}\n");
+
+    if (!settings.tracePath.empty() && !writeChromeTrace(settings.tracePath.c_str())) {
+        return 1;
+    }
+    return consistent ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+#include "Christofides.h"
+#include "DisjointSets.h"
+#include "NeighbourLists.h"
+#include "PointGrid.h"
+#include "SpaceFillingCurve.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+namespace {
+
+using Edge = std::pair<PointId, PointId>;
+
+constexpr PointId NONE = ~PointId{0};
+
+// Nearest partner searches between deadline checks
+constexpr std::size_t checkInterval = 1024;
+
+// The candidate edges of cities, none if deadline expires before they are sorted
+std::vector<CandidateEdge> candidateEdges(const PointStore& cities, std::size_t neighbours,
+                                          const Deadline& deadline) {
+    NeighbourLists lists;
+    if (!lists.build(cities, neighbours, deadline)) {
+        return {};
+    }
+    return sortedCandidateEdges(cities, lists, deadline);
+}
+
+// Kruskal's over the candidate edges, then over the edges of a curve tour between
+// the pieces left, which always connects them. No tree if deadline expires before
+// the candidates are ready.
+std::vector<Edge> spanningTree(const PointStore& cities, std::size_t neighbours, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("spanningTree");
+    const std::size_t count = cities.size();
+    const std::vector<CandidateEdge> candidates = candidateEdges(cities, neighbours, deadline);
+    if (candidates.empty() && deadline.expired()) {
+        return {};
+    }
+    std::vector<Edge> tree;
+    tree.reserve(count - 1);
+    DisjointSets components(count);
+    for (const CandidateEdge& edge : candidates) {
+        if (components.unite(edge.a, edge.b)) {
+            tree.emplace_back(edge.a, edge.b);
+        }
+    }
+    if (components.count() == 1) {
+        return tree;
+    }
+
+    std::vector<CandidateEdge> bridges;
+    const Tour curve = buildCurveTour(cities, CurveType::Moore);
+    for (std::size_t i = 0; i < count; ++i) {
+        const PointId a = curve[i];
+        const PointId b = curve[i + 1 < count ? i + 1 : 0];
+        if (components.find(a) != components.find(b)) {
+            const float dx = cities.x(a) - cities.x(b);
+            const float dy = cities.y(a) - cities.y(b);
+            bridges.push_back({std::sqrt(dx * dx + dy * dy), std::min(a, b), std::max(a, b)});
+        }
+    }
+    std::sort(bridges.begin(), bridges.end(), [](const CandidateEdge& first, const CandidateEdge& second) {
+        if (first.length != second.length) {
+            return first.length < second.length;
+        }
+        return first.a != second.a ? first.a < second.a : first.b < second.b;
+    });
+    for (const CandidateEdge& edge : bridges) {
+        if (components.unite(edge.a, edge.b)) {
+            tree.emplace_back(edge.a, edge.b);
+        }
+    }
+    return tree;
+}
+
+// Pairs up the odd cities, greedily over their candidates first, nearest first after
+// until deadline expires, in ID order from then on
+std::vector<Edge> matchOdd(const PointStore& cities, const std::vector<PointId>& odd, std::size_t neighbours,
+                           const Deadline& deadline) {
+    TSM_TRACE_SCOPE("matching");
+    PointStore oddCities;
+    oddCities.reserve(odd.size());
+    for (PointId city : odd) {
+        oddCities.add(cities.x(city), cities.y(city));
+    }
+
+    std::vector<Edge> matching;
+    matching.reserve(odd.size() / 2);
+    std::vector<bool> matched(odd.size(), false);
+    for (const CandidateEdge& edge : candidateEdges(oddCities, neighbours, deadline)) {
+        if (!matched[edge.a] && !matched[edge.b]) {
+            matched[edge.a] = true;
+            matched[edge.b] = true;
+            matching.emplace_back(odd[edge.a], odd[edge.b]);
+        }
+    }
+
+    std::vector<PointId> unmatched;
+    for (std::size_t i = 0; i < odd.size(); ++i) {
+        if (!matched[i]) {
+            unmatched.push_back(static_cast<PointId>(i));
+        }
+    }
+    PointGrid left(oddCities, unmatched);
+    PointId waiting = NONE;
+    std::size_t searches = 0;
+    bool expired = false;
+    for (PointId city : unmatched) {
+        if (!left.contains(city)) {
+            continue;
+        }
+        left.remove(city);
+        if (!expired && ++searches % checkInterval == 0) {
+            expired = deadline.expired();
+        }
+        if (expired) {
+            if (waiting == NONE) {
+                waiting = city;
+            } else {
+                matching.emplace_back(odd[waiting], odd[city]);
+                waiting = NONE;
+            }
+            continue;
+        }
+        const PointId partner = static_cast<PointId>(left.nearest(oddCities.x(city), oddCities.y(city)));
+        left.remove(partner);
+        matching.emplace_back(odd[city], odd[partner]);
+    }
+    return matching;
+}
+
+// Euler circuit of the multigraph from city 0, keeping each city's first visit
+Tour shortcutEulerCircuit(std::size_t count, const std::vector<Edge>& edges) {
+    TSM_TRACE_SCOPE("eulerCircuit");
+    // Incident edges of every city, flat
+    std::vector<std::size_t> starts(count + 1, 0);
+    for (const Edge& edge : edges) {
+        ++starts[edge.first + 1];
+        ++starts[edge.second + 1];
+    }
+    for (std::size_t city = 0; city < count; ++city) {
+        starts[city + 1] += starts[city];
+    }
+    std::vector<std::size_t> incident(starts.back());
+    std::vector<std::size_t> filled(starts.begin(), starts.end() - 1);
+    for (std::size_t e = 0; e < edges.size(); ++e) {
+        incident[filled[edges[e].first]++] = e;
+        incident[filled[edges[e].second]++] = e;
+    }
+
+    // Hierholzer's algorithm with an explicit stack. Cities come off the stack in
+    // circuit order, reversed, which walks the same circuit.
+    std::vector<bool> used(edges.size(), false);
+    std::vector<std::size_t> nextEdge(starts.begin(), starts.end() - 1);
+    std::vector<bool> visited(count, false);
+    Tour tour;
+    tour.reserve(count);
+    std::vector<PointId> stack = {0};
+    while (!stack.empty()) {
+        const PointId city = stack.back();
+        std::size_t& cursor = nextEdge[city];
+        while (cursor < starts[city + 1] && used[incident[cursor]]) {
+            ++cursor;
+        }
+        if (cursor == starts[city + 1]) {
+            stack.pop_back();
+            if (!visited[city]) {
+                visited[city] = true;
+                tour.push_back(city);
+            }
+            continue;
+        }
+        const Edge& edge = edges[incident[cursor]];
+        used[incident[cursor]] = true;
+        stack.push_back(edge.first == city ? edge.second : edge.first);
+    }
+    return tour;
+}
+
+} // namespace
+
+Tour buildChristofidesTour(const PointStore& cities, std::size_t neighbours, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("christofidesTour");
+    const std::size_t count = cities.size();
+    if (count <= 3) {
+        Tour tour(count);
+        for (std::size_t city = 0; city < count; ++city) {
+            tour[city] = static_cast<PointId>(city);
+        }
+        return tour;
+    }
+
+    std::vector<Edge> edges = spanningTree(cities, neighbours, deadline);
+    if (edges.empty()) {
+        return buildCurveTour(cities, CurveType::Moore);
+    }
+    if (deadline.expired()) {
+        // Every city has even degree in the doubled tree, its circuit is a tree walk
+        const std::size_t treeEdges = edges.size();
+        edges.reserve(2 * treeEdges);
+        for (std::size_t e = 0; e < treeEdges; ++e) {
+            edges.push_back(edges[e]);
+        }
+        return shortcutEulerCircuit(count, edges);
+    }
+    std::vector<std::size_t> degrees(count, 0);
+    for (const Edge& edge : edges) {
+        ++degrees[edge.first];
+        ++degrees[edge.second];
+    }
+    std::vector<PointId> odd;
+    for (std::size_t city = 0; city < count; ++city) {
+        if (degrees[city] % 2 == 1) {
+            odd.push_back(static_cast<PointId>(city));
+        }
+    }
+    std::vector<Edge> matching = matchOdd(cities, odd, neighbours, deadline);
+    edges.insert(edges.end(), matching.begin(), matching.end());
+    return shortcutEulerCircuit(count, edges);
+}
@@ -0,0 +1,24 @@
+#ifndef CHRISTOFIDES_H
+#define CHRISTOFIDES_H
+
+#include "Deadline.h"
+#include "PointStore.h"
+#include "Tour.h"
+#include <cstddef>
+
+// Christofides' construction: a minimum spanning tree, a perfect matching of the
+// tree's odd-degree cities, and an Euler circuit of both shortcut past cities it
+// visited already. Sized for large instances rather than for the 3/2 guarantee:
+// - the tree is Kruskal's over the k nearest neighbour candidates, which holds the
+//   exact tree unless clusters lie far apart, and any pieces this leaves are joined
+//   along a Moore curve tour,
+// - the matching is greedy over the odd cities' own candidates, the rest paired
+//   nearest first, instead of minimum weight.
+// O(n k log n) time and O(n k) memory. Tours are typically about 20% longer than
+// optimal, no better than greedy edge tours: most of Christofides' edge over them
+// comes from the minimum weight matching. Once deadline expires the tree is walked
+// without the matching, or the odd cities left are paired in ID order, and if the
+// candidates are not ready yet the Moore curve tour is returned.
+Tour buildChristofidesTour(const PointStore& cities, std::size_t neighbours = 10, const Deadline& deadline = Deadline());
+
+#endif // CHRISTOFIDES_H
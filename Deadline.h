@@ -0,0 +1,31 @@
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <atomic>
+#include <chrono>
+#include <limits>
+
+// When a tour construction has to give up: timeLimitSeconds after the Deadline was
+// made, or once stop is set. The default one never expires. Constructions check it in
+// their outer loops and finish a tour cut short cheaply, see appendAlongCurve.
+class Deadline {
+public:
+    explicit Deadline(double timeLimitSeconds = std::numeric_limits<double>::infinity(),
+                      const std::atomic<bool>* stop = nullptr)
+        : start(std::chrono::steady_clock::now()), timeLimitSeconds(timeLimitSeconds), stop(stop) {}
+
+    bool expired() const {
+        if (stop != nullptr && stop->load(std::memory_order_relaxed)) {
+            return true;
+        }
+        return timeLimitSeconds != std::numeric_limits<double>::infinity() &&
+               std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() > timeLimitSeconds;
+    }
+
+private:
+    std::chrono::steady_clock::time_point start;
+    double timeLimitSeconds;
+    const std::atomic<bool>* stop;
+};
+
+#endif // DEADLINE_H
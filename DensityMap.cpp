@@ -0,0 +1,171 @@
+#include "DensityMap.h"
+#include "LineRasterizer.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+// Brightness 0..255 of a pixel hit count times, on a log scale up to the densest pixel.
+// Any hit gets at least a third of full brightness so isolated points remain visible.
+std::uint32_t brightness(std::uint32_t count, float logMaximum) {
+    if (count == 0) {
+        return 0;
+    }
+    float scaled = logMaximum > 0.0f ? std::log(static_cast<float>(count)) / logMaximum : 1.0f;
+    return static_cast<std::uint32_t>(85.0f + 170.0f * std::min(scaled, 1.0f));
+}
+
+} // namespace
+
+template <typename Rows, typename Visit>
+void DensityMap::forEachBand(std::size_t items, Rows&& rows, Visit&& visit) const {
+    // Two bands per thread balance uneven densities. Band b covers rows
+    // [height * b / bands, height * (b + 1) / bands), the split forEachChunk makes.
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t bands = std::min(std::size_t{pool.size()} * 2, static_cast<std::size_t>(height));
+    if (bands == 0 || items == 0) {
+        return;
+    }
+    std::vector<std::uint32_t> bandOf(static_cast<std::size_t>(height));
+    for (std::size_t band = 0; band < bands; ++band) {
+        const std::size_t top = static_cast<std::size_t>(height) * band / bands;
+        const std::size_t bottom = static_cast<std::size_t>(height) * (band + 1) / bands;
+        std::fill(bandOf.begin() + top, bandOf.begin() + bottom, static_cast<std::uint32_t>(band));
+    }
+
+    // Counting sort of the items by band, over as many chunks of items as there are
+    // bands: count each chunk's items per band, turn the counts into where they go,
+    // then put them there. Items touching several bands go into each of them.
+    const std::size_t chunks = bands;
+    std::vector<std::size_t> next(chunks * bands, 0);
+    auto forEachBandOfItem = [&](std::size_t begin, std::size_t end, auto&& function) {
+        int first = 0;
+        int last = 0;
+        for (std::size_t i = begin; i < end; ++i) {
+            if (!rows(i, first, last)) {
+                continue;
+            }
+            for (std::uint32_t band = bandOf[first]; band <= bandOf[last]; ++band) {
+                function(i, band);
+            }
+        }
+    };
+    pool.forEachChunk(items, chunks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::size_t* counts = next.data() + chunk * bands;
+        forEachBandOfItem(begin, end, [counts](std::size_t, std::uint32_t band) { ++counts[band]; });
+    });
+    std::vector<std::size_t> bandStarts(bands + 1);
+    std::size_t total = 0;
+    for (std::size_t band = 0; band < bands; ++band) {
+        bandStarts[band] = total;
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            const std::size_t count = next[chunk * bands + band];
+            next[chunk * bands + band] = total;
+            total += count;
+        }
+    }
+    bandStarts[bands] = total;
+    std::vector<std::uint32_t> sorted(total);
+    pool.forEachChunk(items, chunks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        std::size_t* positions = next.data() + chunk * bands;
+        forEachBandOfItem(begin, end, [&](std::size_t i, std::uint32_t band) {
+            sorted[positions[band]++] = static_cast<std::uint32_t>(i);
+        });
+    });
+
+    pool.forEachChunk(static_cast<std::size_t>(height), bands, [&](std::size_t band, std::size_t top, std::size_t bottom) {
+        for (std::size_t k = bandStarts[band]; k < bandStarts[band + 1]; ++k) {
+            visit(sorted[k], static_cast<int>(top), static_cast<int>(bottom));
+        }
+    });
+}
+
+void DensityMap::reset(int newWidth, int newHeight) {
+    width = std::max(newWidth, 0);
+    height = std::max(newHeight, 0);
+    for (std::vector<std::uint32_t>& layer : counts) {
+        layer.assign(static_cast<std::size_t>(width) * height, 0);
+    }
+}
+
+void DensityMap::clear(Layer layer) {
+    std::fill(counts[layer].begin(), counts[layer].end(), 0);
+}
+
+void DensityMap::addPoints(Layer layer, const PointStore& points) {
+    TSM_TRACE_SCOPE("densityPoints");
+    std::uint32_t* target = counts[layer].data();
+    const float* xs = points.xData();
+    const float* ys = points.yData();
+    const float maxX = static_cast<float>(width);
+    const float maxY = static_cast<float>(height);
+    auto rows = [&](std::size_t i, int& first, int& last) {
+        // Written so NaN coordinates are skipped too
+        if (!(ys[i] >= 0.0f && ys[i] < maxY && xs[i] >= 0.0f && xs[i] < maxX)) {
+            return false;
+        }
+        first = last = static_cast<int>(ys[i]);
+        return true;
+    };
+    forEachBand(points.size(), rows, [&](std::size_t i, int, int) {
+        ++target[static_cast<std::size_t>(ys[i]) * width + static_cast<std::size_t>(xs[i])];
+    });
+}
+
+void DensityMap::addPath(Layer layer, const PointStore& path) {
+    TSM_TRACE_SCOPE("densityPath");
+    if (path.size() < 2) {
+        return;
+    }
+
+    std::uint32_t* target = counts[layer].data();
+    const float* xs = path.xData();
+    const float* ys = path.yData();
+    const float maxY = static_cast<float>(height);
+    auto rows = [&](std::size_t i, int& first, int& last) {
+        // A row more on either side, a step's rounding may take it just past an endpoint.
+        // Also skips NaN.
+        const float low = std::min(ys[i], ys[i + 1]) - 1.0f;
+        const float high = std::max(ys[i], ys[i + 1]) + 1.0f;
+        if (!(high >= 0.0f && low < maxY)) {
+            return false;
+        }
+        first = low < 0.0f ? 0 : static_cast<int>(low);
+        last = high >= maxY ? height - 1 : static_cast<int>(high);
+        return true;
+    };
+    forEachBand(path.size() - 1, rows, [&](std::size_t i, int top, int bottom) {
+        rasterizeLine(xs[i], ys[i], xs[i + 1], ys[i + 1], 0, top, width, bottom, [&](int x, int y) {
+            ++target[static_cast<std::size_t>(y) * width + x];
+        });
+    });
+}
+
+void DensityMap::toArgb(std::vector<std::uint32_t>& pixels) const {
+    TSM_TRACE_SCOPE("densityColour");
+    const std::size_t size = static_cast<std::size_t>(width) * height;
+    pixels.resize(size);
+    ThreadPool& pool = ThreadPool::shared();
+
+    float logMaximum[LAYER_COUNT];
+    for (int layer = 0; layer < LAYER_COUNT; ++layer) {
+        const std::uint32_t* source = counts[layer].data();
+        std::uint32_t maximum = pool.parallelReduce(size, 1 << 16, std::uint32_t{0},
+            [&](std::size_t begin, std::size_t end) { return *std::max_element(source + begin, source + end); },
+            [](std::uint32_t a, std::uint32_t b) { return std::max(a, b); });
+        logMaximum[layer] = maximum > 1 ? std::log(static_cast<float>(maximum)) : 0.0f;
+    }
+
+    pool.parallelFor(size, 1 << 14, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::uint32_t city = brightness(counts[Cities][i], logMaximum[Cities]);
+            std::uint32_t net = brightness(counts[Net][i], logMaximum[Net]);
+            std::uint32_t tour = brightness(counts[Tour][i], logMaximum[Tour]);
+            std::uint32_t red = std::max(city, tour);
+            std::uint32_t green = std::max(city, net);
+            pixels[i] = 0xFF000000u | (red << 16) | (green << 8) | city;
+        }
+    });
+}
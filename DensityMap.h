@@ -0,0 +1,53 @@
+#ifndef DENSITYMAP_H
+#define DENSITYMAP_H
+
+#include "PointStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Level-of-detail view of an instance: per layer, how many points or tour edges land
+// on every pixel of a width x height image. The input is sorted once into bands of
+// rows by the rows it touches, then every band is counted by one task, so counting
+// needs no atomics. The cost is linear in points plus edge pixels, no matter how many
+// points share a pixel, so instances far larger than the pixel count still draw quickly.
+class DensityMap {
+public:
+    enum Layer { Cities, Net, Tour, LAYER_COUNT };
+
+    // Resize to width x height pixels and zero every layer
+    void reset(int width, int height);
+
+    // Zero one layer, to count it again without the others
+    void clear(Layer layer);
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+
+    // Count each point at the pixel it falls on, points outside the image are skipped
+    void addPoints(Layer layer, const PointStore& points);
+
+    // Count the pixels of the edges between consecutive points of path
+    void addPath(Layer layer, const PointStore& path);
+
+    std::uint32_t count(Layer layer, int x, int y) const {
+        return counts[layer][static_cast<std::size_t>(y) * width + x];
+    }
+
+    // Colour image as 0xAARRGGBB, row by row: cities white, net green and tour red,
+    // each scaled logarithmically to its densest pixel so single points stay visible.
+    void toArgb(std::vector<std::uint32_t>& pixels) const;
+
+private:
+    // For items 0 to items - 1, rows(i, first, last) gives the rows [first, last] item i
+    // touches and returns false if it touches none. Then visit(i, top, bottom) runs once
+    // for every band of rows [top, bottom) the item touches, the bands in parallel.
+    template <typename Rows, typename Visit>
+    void forEachBand(std::size_t items, Rows&& rows, Visit&& visit) const;
+
+    int width = 0;
+    int height = 0;
+    std::vector<std::uint32_t> counts[LAYER_COUNT];
+};
+
+#endif // DENSITYMAP_H
@@ -0,0 +1,50 @@
+#ifndef DISJOINTSETS_H
+#define DISJOINTSETS_H
+
+#include "PointStore.h"
+#include <cstddef>
+#include <numeric>
+#include <utility>
+#include <vector>
+
+// Union-find over cities with path halving and union by size, near O(1) per call.
+class DisjointSets {
+public:
+    explicit DisjointSets(std::size_t count) : parents(count), sizes(count, 1), sets(count) {
+        std::iota(parents.begin(), parents.end(), PointId{0});
+    }
+
+    PointId find(PointId city) {
+        while (parents[city] != city) {
+            parents[city] = parents[parents[city]];
+            city = parents[city];
+        }
+        return city;
+    }
+
+    // Merge the sets of a and b. False if they already were one set.
+    bool unite(PointId a, PointId b) {
+        a = find(a);
+        b = find(b);
+        if (a == b) {
+            return false;
+        }
+        if (sizes[a] < sizes[b]) {
+            std::swap(a, b);
+        }
+        parents[b] = a;
+        sizes[a] += sizes[b];
+        --sets;
+        return true;
+    }
+
+    // Number of disjoint sets left
+    std::size_t count() const { return sets; }
+
+private:
+    std::vector<PointId> parents;
+    std::vector<PointId> sizes;
+    std::size_t sets;
+};
+
+#endif // DISJOINTSETS_H
@@ -0,0 +1,340 @@
+#include "DistanceKernels.h"
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TSM_X86_DISPATCH 1
+#include <immintrin.h>
+#define TSM_TARGET(isa) __attribute__((target(isa)))
+// Keeps scalar helpers out of the ISA-specific kernels, where the compiler could
+// contract them into FMA and make results differ between levels
+#define TSM_SCALAR __attribute__((noinline))
+// Forces lanes stored right before _mm256_zeroupper to be read back from memory.
+// Otherwise the compiler may keep them in zmm16-31, which vzeroupper leaves alone,
+// and extract them after it, dirtying the upper state again.
+#define TSM_SPILL(lanes) __asm__ volatile("" : : "r"(lanes) : "memory")
+#else
+#define TSM_X86_DISPATCH 0
+#define TSM_SCALAR
+#endif
+
+namespace {
+
+TSM_SCALAR void squaredDistancesScalar(float qx, float qy, const float* xs, const float* ys,
+                            std::size_t count, float* out) {
+    for (std::size_t i = 0; i < count; ++i) {
+        float dx = xs[i] - qx;
+        float dy = ys[i] - qy;
+        out[i] = dx * dx + dy * dy;
+    }
+}
+
+// Scalar argmin over [begin, count), merged into an existing best match
+TSM_SCALAR std::size_t nearestTail(float qx, float qy, const float* xs, const float* ys, std::size_t begin,
+                        std::size_t count, std::size_t bestIndex, float& bestSquaredDistance) {
+    for (std::size_t i = begin; i < count; ++i) {
+        float dx = xs[i] - qx;
+        float dy = ys[i] - qy;
+        float distance = dx * dx + dy * dy;
+        if (distance < bestSquaredDistance) {
+            bestSquaredDistance = distance;
+            bestIndex = i;
+        }
+    }
+    return bestIndex;
+}
+
+TSM_SCALAR std::size_t nearestScalar(float qx, float qy, const float* xs, const float* ys,
+                          std::size_t count, float& bestSquaredDistance) {
+    bestSquaredDistance = std::numeric_limits<float>::max();
+    return nearestTail(qx, qy, xs, ys, 0, count, count, bestSquaredDistance);
+}
+
+TSM_SCALAR double sumScalar(const float* values, std::size_t count) {
+    double total = 0.0;
+    for (std::size_t i = 0; i < count; ++i) {
+        total += values[i];
+    }
+    return total;
+}
+
+// The AVX kernels below clear the upper register halves with _mm256_zeroupper before
+// returning or calling scalar code. Compilers do not insert it for functions built
+// with a target attribute, and dirty upper state makes every later SSE instruction,
+// including those inside libm, pay an AVX-SSE transition penalty.
+
+// Reduce per-lane argmin results to a single one, ties going to the lowest index
+std::size_t reduceLanes(const float* distances, const int* indices, int lanes,
+                        std::size_t count, float& bestSquaredDistance) {
+    std::size_t bestIndex = count;
+    bestSquaredDistance = std::numeric_limits<float>::max();
+    for (int lane = 0; lane < lanes; ++lane) {
+        std::size_t index = static_cast<std::size_t>(indices[lane]);
+        if (distances[lane] < bestSquaredDistance ||
+            (distances[lane] == bestSquaredDistance && index < bestIndex)) {
+            bestSquaredDistance = distances[lane];
+            bestIndex = index;
+        }
+    }
+    return bestIndex;
+}
+
+#if TSM_X86_DISPATCH
+
+TSM_TARGET("sse2")
+void squaredDistancesSse2(float qx, float qy, const float* xs, const float* ys,
+                          std::size_t count, float* out) {
+    const __m128 vqx = _mm_set1_ps(qx);
+    const __m128 vqy = _mm_set1_ps(qy);
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)));
+    }
+    squaredDistancesScalar(qx, qy, xs + i, ys + i, count - i, out + i);
+}
+
+TSM_TARGET("sse2")
+std::size_t nearestSse2(float qx, float qy, const float* xs, const float* ys,
+                        std::size_t count, float& bestSquaredDistance) {
+    if (count < 4) {
+        return nearestScalar(qx, qy, xs, ys, count, bestSquaredDistance);
+    }
+
+    const __m128 vqx = _mm_set1_ps(qx);
+    const __m128 vqy = _mm_set1_ps(qy);
+    const __m128i step = _mm_set1_epi32(4);
+    __m128 best = _mm_set1_ps(std::numeric_limits<float>::max());
+    __m128i bestIndices = _mm_setzero_si128();
+    __m128i indices = _mm_setr_epi32(0, 1, 2, 3);
+
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 dx = _mm_sub_ps(_mm_loadu_ps(xs + i), vqx);
+        __m128 dy = _mm_sub_ps(_mm_loadu_ps(ys + i), vqy);
+        __m128 distance = _mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy));
+        // Branch-free select of closer lanes, SSE2 has no blend instruction
+        __m128i closer = _mm_castps_si128(_mm_cmplt_ps(distance, best));
+        best = _mm_min_ps(distance, best);
+        bestIndices = _mm_or_si128(_mm_and_si128(closer, indices), _mm_andnot_si128(closer, bestIndices));
+        indices = _mm_add_epi32(indices, step);
+    }
+
+    alignas(16) float laneDistances[4];
+    alignas(16) int laneIndices[4];
+    _mm_store_ps(laneDistances, best);
+    _mm_store_si128(reinterpret_cast<__m128i*>(laneIndices), bestIndices);
+    std::size_t bestIndex = reduceLanes(laneDistances, laneIndices, 4, count, bestSquaredDistance);
+    return nearestTail(qx, qy, xs, ys, i, count, bestIndex, bestSquaredDistance);
+}
+
+TSM_TARGET("sse2")
+double sumSse2(const float* values, std::size_t count) {
+    __m128d total = _mm_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        __m128 block = _mm_loadu_ps(values + i);
+        total = _mm_add_pd(total, _mm_cvtps_pd(block));
+        total = _mm_add_pd(total, _mm_cvtps_pd(_mm_movehl_ps(block, block)));
+    }
+    alignas(16) double lanes[2];
+    _mm_store_pd(lanes, total);
+    return lanes[0] + lanes[1] + sumScalar(values + i, count - i);
+}
+
+TSM_TARGET("avx2")
+void squaredDistancesAvx2(float qx, float qy, const float* xs, const float* ys,
+                          std::size_t count, float* out) {
+    const __m256 vqx = _mm256_set1_ps(qx);
+    const __m256 vqy = _mm256_set1_ps(qy);
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+        _mm256_storeu_ps(out + i, _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)));
+    }
+    _mm256_zeroupper();
+    squaredDistancesScalar(qx, qy, xs + i, ys + i, count - i, out + i);
+}
+
+TSM_TARGET("avx2")
+std::size_t nearestAvx2(float qx, float qy, const float* xs, const float* ys,
+                        std::size_t count, float& bestSquaredDistance) {
+    if (count < 8) {
+        return nearestScalar(qx, qy, xs, ys, count, bestSquaredDistance);
+    }
+
+    const __m256 vqx = _mm256_set1_ps(qx);
+    const __m256 vqy = _mm256_set1_ps(qy);
+    const __m256i step = _mm256_set1_epi32(8);
+    __m256 best = _mm256_set1_ps(std::numeric_limits<float>::max());
+    __m256i bestIndices = _mm256_setzero_si256();
+    __m256i indices = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 dx = _mm256_sub_ps(_mm256_loadu_ps(xs + i), vqx);
+        __m256 dy = _mm256_sub_ps(_mm256_loadu_ps(ys + i), vqy);
+        __m256 distance = _mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy));
+        __m256 closer = _mm256_cmp_ps(distance, best, _CMP_LT_OQ);
+        best = _mm256_min_ps(distance, best);
+        bestIndices = _mm256_castps_si256(_mm256_blendv_ps(
+            _mm256_castsi256_ps(bestIndices), _mm256_castsi256_ps(indices), closer));
+        indices = _mm256_add_epi32(indices, step);
+    }
+
+    alignas(32) float laneDistances[8];
+    alignas(32) int laneIndices[8];
+    _mm256_store_ps(laneDistances, best);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(laneIndices), bestIndices);
+    TSM_SPILL(laneDistances);
+    TSM_SPILL(laneIndices);
+    _mm256_zeroupper();
+    std::size_t bestIndex = reduceLanes(laneDistances, laneIndices, 8, count, bestSquaredDistance);
+    return nearestTail(qx, qy, xs, ys, i, count, bestIndex, bestSquaredDistance);
+}
+
+TSM_TARGET("avx2")
+double sumAvx2(const float* values, std::size_t count) {
+    __m256d total = _mm256_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256 block = _mm256_loadu_ps(values + i);
+        total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_castps256_ps128(block)));
+        total = _mm256_add_pd(total, _mm256_cvtps_pd(_mm256_extractf128_ps(block, 1)));
+    }
+    alignas(32) double lanes[4];
+    _mm256_store_pd(lanes, total);
+    TSM_SPILL(lanes);
+    _mm256_zeroupper();
+    return lanes[0] + lanes[1] + lanes[2] + lanes[3] + sumScalar(values + i, count - i);
+}
+
+TSM_TARGET("avx512f")
+void squaredDistancesAvx512(float qx, float qy, const float* xs, const float* ys,
+                            std::size_t count, float* out) {
+    const __m512 vqx = _mm512_set1_ps(qx);
+    const __m512 vqy = _mm512_set1_ps(qy);
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(xs + i), vqx);
+        __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(ys + i), vqy);
+        _mm512_storeu_ps(out + i, _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy)));
+    }
+    _mm256_zeroupper();
+    squaredDistancesScalar(qx, qy, xs + i, ys + i, count - i, out + i);
+}
+
+TSM_TARGET("avx512f")
+std::size_t nearestAvx512(float qx, float qy, const float* xs, const float* ys,
+                          std::size_t count, float& bestSquaredDistance) {
+    if (count < 16) {
+        return nearestScalar(qx, qy, xs, ys, count, bestSquaredDistance);
+    }
+
+    const __m512 vqx = _mm512_set1_ps(qx);
+    const __m512 vqy = _mm512_set1_ps(qy);
+    const __m512i step = _mm512_set1_epi32(16);
+    __m512 best = _mm512_set1_ps(std::numeric_limits<float>::max());
+    __m512i bestIndices = _mm512_setzero_si512();
+    __m512i indices = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        __m512 dx = _mm512_sub_ps(_mm512_loadu_ps(xs + i), vqx);
+        __m512 dy = _mm512_sub_ps(_mm512_loadu_ps(ys + i), vqy);
+        __m512 distance = _mm512_add_ps(_mm512_mul_ps(dx, dx), _mm512_mul_ps(dy, dy));
+        __mmask16 closer = _mm512_cmp_ps_mask(distance, best, _CMP_LT_OQ);
+        best = _mm512_mask_blend_ps(closer, best, distance);
+        bestIndices = _mm512_mask_blend_epi32(closer, bestIndices, indices);
+        indices = _mm512_add_epi32(indices, step);
+    }
+
+    alignas(64) float laneDistances[16];
+    alignas(64) int laneIndices[16];
+    _mm512_store_ps(laneDistances, best);
+    _mm512_store_si512(laneIndices, bestIndices);
+    TSM_SPILL(laneDistances);
+    TSM_SPILL(laneIndices);
+    _mm256_zeroupper();
+    std::size_t bestIndex = reduceLanes(laneDistances, laneIndices, 16, count, bestSquaredDistance);
+    return nearestTail(qx, qy, xs, ys, i, count, bestIndex, bestSquaredDistance);
+}
+
+TSM_TARGET("avx512f")
+double sumAvx512(const float* values, std::size_t count) {
+    const __mmask8 all = 0xFF;
+    __m512d total = _mm512_setzero_pd();
+    std::size_t i = 0;
+    for (; i + 16 <= count; i += 16) {
+        total = _mm512_add_pd(total, _mm512_maskz_cvtps_pd(all, _mm256_loadu_ps(values + i)));
+        total = _mm512_add_pd(total, _mm512_maskz_cvtps_pd(all, _mm256_loadu_ps(values + i + 8)));
+    }
+    alignas(64) double lanes[8];
+    _mm512_store_pd(lanes, total);
+    TSM_SPILL(lanes);
+    _mm256_zeroupper();
+    double result = 0.0;
+    for (double lane : lanes) {
+        result += lane;
+    }
+    return result + sumScalar(values + i, count - i);
+}
+
+#endif // TSM_X86_DISPATCH
+
+const DistanceKernels scalarKernels{SimdLevel::Scalar, squaredDistancesScalar, nearestScalar, sumScalar};
+#if TSM_X86_DISPATCH
+const DistanceKernels sse2Kernels{SimdLevel::SSE2, squaredDistancesSse2, nearestSse2, sumSse2};
+const DistanceKernels avx2Kernels{SimdLevel::AVX2, squaredDistancesAvx2, nearestAvx2, sumAvx2};
+const DistanceKernels avx512Kernels{SimdLevel::AVX512, squaredDistancesAvx512, nearestAvx512, sumAvx512};
+#endif
+
+} // namespace
+
+SimdLevel detectSimdLevel() {
+#if TSM_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        return SimdLevel::AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return SimdLevel::AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return SimdLevel::SSE2;
+    }
+#endif
+    return SimdLevel::Scalar;
+}
+
+const char* simdLevelName(SimdLevel level) {
+    switch (level) {
+        case SimdLevel::SSE2: return "sse2";
+        case SimdLevel::AVX2: return "avx2";
+        case SimdLevel::AVX512: return "avx512";
+        default: return "scalar";
+    }
+}
+
+const DistanceKernels& getDistanceKernels(SimdLevel level) {
+    static const SimdLevel supported = detectSimdLevel();
+    if (level > supported) {
+        level = supported;
+    }
+
+#if TSM_X86_DISPATCH
+    switch (level) {
+        case SimdLevel::AVX512: return avx512Kernels;
+        case SimdLevel::AVX2: return avx2Kernels;
+        case SimdLevel::SSE2: return sse2Kernels;
+        default: break;
+    }
+#endif
+    return scalarKernels;
+}
+
+const DistanceKernels& getDistanceKernels() {
+    static const DistanceKernels& kernels = getDistanceKernels(detectSimdLevel());
+    return kernels;
+}
@@ -0,0 +1,48 @@
+#ifndef DISTANCEKERNELS_H
+#define DISTANCEKERNELS_H
+
+#include <cstddef>
+
+// Instruction set used by a kernel table. Higher levels include the lower ones.
+enum class SimdLevel {
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+// Batch distance kernels over structure-of-arrays coordinates. All kernels work
+// on squared distances, so callers only take a sqrt for the final answer.
+// squaredDistances and nearest return the same results on every level, sum does not.
+struct DistanceKernels {
+    SimdLevel level;
+
+    // out[i] = squared distance from (qx, qy) to (xs[i], ys[i])
+    void (*squaredDistances)(float qx, float qy, const float* xs, const float* ys,
+                             std::size_t count, float* out);
+
+    // Index of the point closest to (qx, qy), or count if count is 0. Ties go to the
+    // lowest index. bestSquaredDistance receives the squared distance of the match.
+    // count must fit into 31 bits.
+    std::size_t (*nearest)(float qx, float qy, const float* xs, const float* ys,
+                           std::size_t count, float& bestSquaredDistance);
+
+    // Sum of values, accumulated in double precision. The vector levels keep one
+    // partial sum per lane and add them up at the end, so the result can differ from
+    // the scalar level's sequential sum, and between levels, in the last bits.
+    double (*sum)(const float* values, std::size_t count);
+};
+
+// Best instruction set supported by both the build and the running CPU.
+SimdLevel detectSimdLevel();
+
+const char* simdLevelName(SimdLevel level);
+
+// Kernels for the best supported level, selected once on first use.
+const DistanceKernels& getDistanceKernels();
+
+// Kernels for a specific level. Levels the CPU does not support fall back to the
+// best supported one below it, so the returned table's level may differ.
+const DistanceKernels& getDistanceKernels(SimdLevel level);
+
+#endif // DISTANCEKERNELS_H
@@ -0,0 +1,447 @@
+#include "ElasticNet.h"
+#include "DistanceKernels.h"
+#include "Net.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <numeric>
+#include <vector>
+
+namespace {
+
+// Run function(worker, begin, end) over [0, count) split into one range per worker.
+// The split only depends on count and workers, so per-worker sums are deterministic.
+template<typename Function>
+void parallelFor(unsigned workers, std::size_t count, Function&& function) {
+    std::size_t ranges = count < 2 * std::size_t{workers} ? 1 : workers;
+    ThreadPool::shared().forEachChunk(count, ranges,
+        [&function](std::size_t worker, std::size_t begin, std::size_t end) {
+            function(static_cast<unsigned>(worker), begin, end);
+        });
+}
+
+// Uniform grid over the ring nodes. Nodes are stored sorted by cell in row-major
+// order, so each row of cells covers one contiguous range of the coordinate arrays.
+class NodeGrid {
+public:
+    void build(const std::vector<float>& nodeX, const std::vector<float>& nodeY) {
+        const std::size_t count = nodeX.size();
+        auto [minXIt, maxXIt] = std::minmax_element(nodeX.begin(), nodeX.end());
+        auto [minYIt, maxYIt] = std::minmax_element(nodeY.begin(), nodeY.end());
+        minX = *minXIt;
+        minY = *minYIt;
+        float spanX = std::max(*maxXIt - minX, 1e-6f);
+        float spanY = std::max(*maxYIt - minY, 1e-6f);
+
+        // Aim for about two nodes per cell
+        cellSize = std::sqrt(spanX * spanY / std::max<std::size_t>(count / 2, 1));
+        cellSize = std::max({cellSize, spanX / 4096, spanY / 4096});
+        width = static_cast<int>(spanX / cellSize) + 1;
+        height = static_cast<int>(spanY / cellSize) + 1;
+
+        cellStart.assign(static_cast<std::size_t>(width) * height + 1, 0);
+        std::vector<std::uint32_t> cellOf(count);
+        for (std::size_t i = 0; i < count; ++i) {
+            cellOf[i] = static_cast<std::uint32_t>(cellIndex(cellX(nodeX[i]), cellY(nodeY[i])));
+            ++cellStart[cellOf[i] + 1];
+        }
+        std::partial_sum(cellStart.begin(), cellStart.end(), cellStart.begin());
+
+        xs.resize(count);
+        ys.resize(count);
+        ids.resize(count);
+        std::vector<std::uint32_t> fill(cellStart.begin(), cellStart.end() - 1);
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint32_t slot = fill[cellOf[i]]++;
+            xs[slot] = nodeX[i];
+            ys[slot] = nodeY[i];
+            ids[slot] = static_cast<std::uint32_t>(i);
+        }
+    }
+
+    // Closest node to (qx, qy), searching outwards ring by ring of cells
+    std::uint32_t nearest(float qx, float qy, float& bestSquaredDistance) const {
+        const int cx = cellX(qx);
+        const int cy = cellY(qy);
+        const DistanceKernels& kernels = getDistanceKernels();
+        std::uint32_t best = 0;
+        bestSquaredDistance = std::numeric_limits<float>::max();
+
+        const int maxRing = std::max(width, height);
+        for (int ring = 0; ring <= maxRing; ++ring) {
+            int y0 = std::max(cy - ring, 0);
+            int y1 = std::min(cy + ring, height - 1);
+            for (int y = y0; y <= y1; ++y) {
+                bool edgeRow = y == cy - ring || y == cy + ring;
+                // Inner rows only contribute the two cells on the ring's border
+                int step = edgeRow ? 1 : 2 * ring;
+                for (int x = cx - ring; x <= cx + ring; x += std::max(step, 1)) {
+                    if (x < 0 || x >= width) {
+                        continue;
+                    }
+                    std::size_t cell = cellIndex(x, y);
+                    std::size_t begin = cellStart[cell];
+                    std::size_t end = cellStart[cell + 1];
+                    float distance;
+                    std::size_t index = kernels.nearest(qx, qy, xs.data() + begin, ys.data() + begin,
+                                                        end - begin, distance);
+                    if (index < end - begin && distance < bestSquaredDistance) {
+                        bestSquaredDistance = distance;
+                        best = ids[begin + index];
+                    }
+                }
+            }
+            // Every cell beyond this ring is at least ring cells away
+            float reach = ring * cellSize;
+            if (bestSquaredDistance <= reach * reach) {
+                break;
+            }
+        }
+        return best;
+    }
+
+    // Visit every node within radius of (qx, qy) as visit(node, squaredDistance).
+    // scratch receives the squared distances of whole cell rows at once.
+    template<typename Visit>
+    void forEachWithin(float qx, float qy, float radius, std::vector<float>& scratch, Visit&& visit) const {
+        const DistanceKernels& kernels = getDistanceKernels();
+        const float squaredRadius = radius * radius;
+        int y0 = cellY(qy - radius);
+        int y1 = cellY(qy + radius);
+        for (int y = y0; y <= y1; ++y) {
+            // Only scan the cells of this row that the circle's chord crosses
+            float rowTop = minY + y * cellSize;
+            float dy = std::max({rowTop - qy, qy - (rowTop + cellSize), 0.0f});
+            float halfChord = std::sqrt(std::max(squaredRadius - dy * dy, 0.0f));
+            int x0 = cellX(qx - halfChord);
+            int x1 = cellX(qx + halfChord);
+            std::size_t begin = cellStart[cellIndex(x0, y)];
+            std::size_t end = cellStart[cellIndex(x1, y) + 1];
+            if (scratch.size() < end - begin) {
+                scratch.resize(end - begin);
+            }
+            kernels.squaredDistances(qx, qy, xs.data() + begin, ys.data() + begin, end - begin, scratch.data());
+            for (std::size_t i = begin; i < end; ++i) {
+                float distance = scratch[i - begin];
+                if (distance <= squaredRadius) {
+                    visit(ids[i], distance);
+                }
+            }
+        }
+    }
+
+private:
+    int cellX(float x) const { return std::clamp(static_cast<int>((x - minX) / cellSize), 0, width - 1); }
+    int cellY(float y) const { return std::clamp(static_cast<int>((y - minY) / cellSize), 0, height - 1); }
+    std::size_t cellIndex(int x, int y) const { return static_cast<std::size_t>(y) * width + x; }
+
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float cellSize = 1.0f;
+    int width = 1;
+    int height = 1;
+    std::vector<std::uint32_t> cellStart;
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<std::uint32_t> ids;
+};
+
+// Nodes on the initial ring
+constexpr std::size_t INITIAL_NODES = 8;
+
+// Split the longest ring edges at their midpoints until the ring has targetCount
+// nodes. targetCount may at most double the ring.
+void growRing(std::vector<float>& nodeX, std::vector<float>& nodeY, std::size_t targetCount) {
+    const std::size_t count = nodeX.size();
+    const std::size_t splits = std::min(targetCount, 2 * count) - count;
+
+    std::vector<std::pair<float, std::size_t>> edges(count);
+    for (std::size_t j = 0; j < count; ++j) {
+        std::size_t next = j + 1 == count ? 0 : j + 1;
+        float dx = nodeX[next] - nodeX[j];
+        float dy = nodeY[next] - nodeY[j];
+        edges[j] = {-(dx * dx + dy * dy), j};
+    }
+    std::nth_element(edges.begin(), edges.begin() + splits, edges.end());
+    std::vector<char> split(count, 0);
+    for (std::size_t e = 0; e < splits; ++e) {
+        split[edges[e].second] = 1;
+    }
+
+    std::vector<float> grownX;
+    std::vector<float> grownY;
+    grownX.reserve(count + splits);
+    grownY.reserve(count + splits);
+    for (std::size_t j = 0; j < count; ++j) {
+        grownX.push_back(nodeX[j]);
+        grownY.push_back(nodeY[j]);
+        if (split[j]) {
+            std::size_t next = j + 1 == count ? 0 : j + 1;
+            grownX.push_back(0.5f * (nodeX[j] + nodeX[next]));
+            grownY.push_back(0.5f * (nodeY[j] + nodeY[next]));
+        }
+    }
+    nodeX.swap(grownX);
+    nodeY.swap(grownY);
+}
+
+// Iterations at the final K without the worst city getting closer before the ring
+// counts as settled
+constexpr int SETTLE_ITERATIONS = 20;
+
+// Iterations timed to estimate the cost of annealing
+constexpr int ESTIMATE_ITERATIONS = 4;
+
+// Per-thread accumulators, merged after every iteration
+struct Worker {
+    std::vector<float> deltaX;
+    std::vector<float> deltaY;
+    std::vector<float> weightSum;
+    std::vector<float> scratch;
+    std::vector<std::uint32_t> neighbours;
+    std::vector<float> weights;
+    float maxNearest = 0.0f;
+};
+
+} // namespace
+
+ElasticNetResult solveElasticNet(const PointStore& cities, const ElasticNetOptions& options) {
+    TSM_TRACE_SCOPE("elasticNet");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ElasticNetResult result;
+    const std::size_t cityCount = cities.size();
+    if (cityCount <= 3) {
+        result.tour.resize(cityCount);
+        std::iota(result.tour.begin(), result.tour.end(), std::size_t{0});
+        result.nodes = cities;
+        result.converged = true;
+        return result;
+    }
+
+    // Work in a unit square so K and the tension coefficient keep their usual scale
+    const float* inputX = cities.xData();
+    const float* inputY = cities.yData();
+    auto [minXIt, maxXIt] = std::minmax_element(inputX, inputX + cityCount);
+    auto [minYIt, maxYIt] = std::minmax_element(inputY, inputY + cityCount);
+    const float originX = *minXIt;
+    const float originY = *minYIt;
+    float scale = std::max(*maxXIt - originX, *maxYIt - originY);
+    if (!(scale > 0.0f)) {
+        scale = 1.0f;
+    }
+
+    PointStore unitCities;
+    unitCities.reserve(cityCount);
+    for (std::size_t i = 0; i < cityCount; ++i) {
+        unitCities.add((inputX[i] - originX) / scale, (inputY[i] - originY) / scale);
+    }
+    const float* cityX = unitCities.xData();
+    const float* cityY = unitCities.yData();
+
+    // Mean spacing between cities in unit coordinates
+    const float spanX = (*maxXIt - originX) / scale;
+    const float spanY = (*maxYIt - originY) / scale;
+    const float spacing = std::sqrt(std::max(spanX * spanY, 1e-6f) / static_cast<float>(cityCount));
+
+    // Start with a few nodes on a small circle around the centroid
+    const std::size_t maxNodes = std::max<std::size_t>(INITIAL_NODES, static_cast<std::size_t>(std::ceil(options.nodeRatio * cityCount)));
+    PointStore ring;
+    addRingPoints(ring, calculateCenter(unitCities), 0.1f, static_cast<int>(INITIAL_NODES));
+    std::vector<float> nodeX(ring.xData(), ring.xData() + ring.size());
+    std::vector<float> nodeY(ring.yData(), ring.yData() + ring.size());
+
+    unsigned workers = options.threads != 0 ? options.threads : ThreadPool::shared().size();
+    workers = std::max(workers, 1u);
+    std::vector<Worker> state(workers);
+
+    // Keep the explicit tension step stable: beta * K must stay below 1/2
+    const float maxK = 0.45f / std::max(options.beta, 1e-6f);
+    float k = std::min(options.initialK, maxK);
+    const float finalK = std::min(options.finalK * spacing, k);
+    const float tolerance = options.tolerance * spacing;
+    const float cutoff = -2.0f * std::log(std::clamp(options.weightCutoff, 1e-30f, 1.0f));
+
+    NodeGrid grid;
+    std::vector<float> nextX;
+    std::vector<float> nextY;
+    float decay = options.decay;
+    double firstIterationEnd = 0.0;
+    float settledNearest = std::numeric_limits<float>::max();
+    int settledIterations = 0;
+
+    auto stopped = [&options] { return options.stop != nullptr && options.stop->load(std::memory_order_relaxed); };
+    while (result.iterations < options.maxIterations && elapsed() < options.timeLimitSeconds && !stopped()) {
+        // Add nodes as K shrinks so that edges stay shorter than nodeSpacing * K.
+        // Each city then only ever sees a bounded number of nodes within reach.
+        float ringLength = 0.0f;
+        for (std::size_t j = 0; j < nodeX.size(); ++j) {
+            std::size_t next = j + 1 == nodeX.size() ? 0 : j + 1;
+            ringLength += std::hypot(nodeX[next] - nodeX[j], nodeY[next] - nodeY[j]);
+        }
+        auto wanted = static_cast<std::size_t>(std::ceil(ringLength / (options.nodeSpacing * k)));
+        wanted = std::min(wanted, maxNodes);
+        if (wanted > nodeX.size()) {
+            growRing(nodeX, nodeY, std::min(wanted, 2 * nodeX.size()));
+        }
+
+        const std::size_t nodeCount = nodeX.size();
+        if (nextX.size() != nodeCount) {
+            nextX.resize(nodeCount);
+            nextY.resize(nodeCount);
+            for (Worker& worker : state) {
+                worker.deltaX.resize(nodeCount);
+                worker.deltaY.resize(nodeCount);
+                worker.weightSum.resize(nodeCount);
+            }
+        }
+
+        grid.build(nodeX, nodeY);
+        const float twoKSquared = 2.0f * k * k;
+
+        // Attraction: each city spreads a total weight of one over its nearby nodes
+        parallelFor(workers, cityCount, [&](unsigned index, std::size_t begin, std::size_t end) {
+            Worker& worker = state[index];
+            std::fill(worker.deltaX.begin(), worker.deltaX.end(), 0.0f);
+            std::fill(worker.deltaY.begin(), worker.deltaY.end(), 0.0f);
+            std::fill(worker.weightSum.begin(), worker.weightSum.end(), 0.0f);
+            worker.maxNearest = 0.0f;
+
+            for (std::size_t i = begin; i < end; ++i) {
+                const float x = cityX[i];
+                const float y = cityY[i];
+                float nearestSquared;
+                grid.nearest(x, y, nearestSquared);
+                worker.maxNearest = std::max(worker.maxNearest, nearestSquared);
+
+                // Weights are taken relative to the closest node, so far away cities
+                // still pull on their nearest nodes instead of underflowing to zero
+                const float radius = std::sqrt(nearestSquared + cutoff * k * k);
+                worker.neighbours.clear();
+                worker.weights.clear();
+                float total = 0.0f;
+                grid.forEachWithin(x, y, radius, worker.scratch, [&](std::uint32_t node, float distance) {
+                    float weight = std::exp(std::min(nearestSquared - distance, 0.0f) / twoKSquared);
+                    worker.neighbours.push_back(node);
+                    worker.weights.push_back(weight);
+                    total += weight;
+                });
+
+                const float norm = 1.0f / total;
+                for (std::size_t n = 0; n < worker.neighbours.size(); ++n) {
+                    std::uint32_t node = worker.neighbours[n];
+                    float weight = worker.weights[n] * norm;
+                    worker.deltaX[node] += weight * (x - nodeX[node]);
+                    worker.deltaY[node] += weight * (y - nodeY[node]);
+                    worker.weightSum[node] += weight;
+                }
+            }
+        });
+
+        // Merge the attraction and add the tension between ring neighbours
+        const float tension = options.beta * k;
+        parallelFor(workers, nodeCount, [&](unsigned, std::size_t begin, std::size_t end) {
+            for (std::size_t j = begin; j < end; ++j) {
+                float dx = 0.0f;
+                float dy = 0.0f;
+                float weight = 0.0f;
+                for (const Worker& worker : state) {
+                    dx += worker.deltaX[j];
+                    dy += worker.deltaY[j];
+                    weight += worker.weightSum[j];
+                }
+                // A node claimed by many cities would overshoot their weighted mean,
+                // so the step is capped at moving it onto that mean
+                float pull = options.alpha / std::max(options.alpha * weight, 1.0f);
+                dx *= pull;
+                dy *= pull;
+                std::size_t previous = j == 0 ? nodeCount - 1 : j - 1;
+                std::size_t next = j + 1 == nodeCount ? 0 : j + 1;
+                nextX[j] = nodeX[j] + dx + tension * (nodeX[previous] - 2.0f * nodeX[j] + nodeX[next]);
+                nextY[j] = nodeY[j] + dy + tension * (nodeY[previous] - 2.0f * nodeY[j] + nodeY[next]);
+            }
+        });
+        nodeX.swap(nextX);
+        nodeY.swap(nextY);
+        ++result.iterations;
+
+        float maxNearest = std::sqrt(std::max_element(state.begin(), state.end(), [](const Worker& a, const Worker& b) {
+            return a.maxNearest < b.maxNearest;
+        })->maxNearest);
+        if (maxNearest < tolerance) {
+            result.converged = true;
+            break;
+        }
+
+        // Once K is at its floor the ring has settled when the worst city stops
+        // getting closer to it
+        if (k == finalK) {
+            if (maxNearest < 0.99f * settledNearest) {
+                settledNearest = maxNearest;
+                settledIterations = 0;
+            } else if (++settledIterations >= SETTLE_ITERATIONS) {
+                result.converged = true;
+                break;
+            }
+        }
+
+        // Iterations cost about the same throughout, so the rest of the run takes
+        // log(finalK / k) / log(decay) of them. Anneal faster if that would not fit
+        // into the time budget. The first iteration is left out of the estimate.
+        if (result.iterations == 1) {
+            firstIterationEnd = elapsed();
+        } else if (result.iterations == ESTIMATE_ITERATIONS + 1 && k > finalK) {
+            double iteration = (elapsed() - firstIterationEnd) / ESTIMATE_ITERATIONS;
+            double budget = 0.8 * options.timeLimitSeconds - elapsed();
+            double remaining = std::log(finalK / k) / std::log(decay);
+            if (budget > 0.0 && iteration * remaining > budget) {
+                decay = static_cast<float>(std::max(std::exp(std::log(finalK / k) * iteration / budget), 0.5));
+            }
+        }
+        k = std::max(k * decay, finalK);
+    }
+
+    // Visit cities in ring order of their closest node; cities sharing a node are
+    // ordered along the ring's direction at that node
+    const std::size_t nodeCount = nodeX.size();
+    grid.build(nodeX, nodeY);
+    struct Visit {
+        std::uint32_t node;
+        float along;
+        PointId city;
+    };
+    std::vector<Visit> visits(cityCount);
+    parallelFor(workers, cityCount, [&](unsigned, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            float distance;
+            std::uint32_t node = grid.nearest(cityX[i], cityY[i], distance);
+            std::size_t previous = node == 0 ? nodeCount - 1 : node - 1;
+            std::size_t next = node + 1 == nodeCount ? 0 : node + 1;
+            float along = (cityX[i] - nodeX[node]) * (nodeX[next] - nodeX[previous]) +
+                          (cityY[i] - nodeY[node]) * (nodeY[next] - nodeY[previous]);
+            visits[i] = {node, along, static_cast<PointId>(i)};
+        }
+    });
+    std::sort(visits.begin(), visits.end(), [](const Visit& a, const Visit& b) {
+        if (a.node != b.node) return a.node < b.node;
+        if (a.along != b.along) return a.along < b.along;
+        return a.city < b.city;
+    });
+
+    result.tour.reserve(cityCount);
+    for (const Visit& visit : visits) {
+        result.tour.push_back(visit.city);
+    }
+    result.nodes.reserve(nodeCount);
+    for (std::size_t j = 0; j < nodeCount; ++j) {
+        result.nodes.add(nodeX[j] * scale + originX, nodeY[j] * scale + originY);
+    }
+    result.seconds = elapsed();
+    return result;
+}
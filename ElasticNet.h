@@ -0,0 +1,58 @@
+#ifndef ELASTICNET_H
+#define ELASTICNET_H
+
+#include "PointStore.h"
+#include "Tour.h"
+#include <atomic>
+
+// Parameters of the Durbin-Willshaw elastic net. Cities are scaled into the unit
+// square; initialK is given in those units, the other lengths in units of the mean
+// city spacing, so the defaults work for any instance size or extent.
+struct ElasticNetOptions {
+    // Maximum number of ring nodes per city
+    double nodeRatio = 2.5;
+    // The ring starts with a few nodes and grows by splitting its longest edges,
+    // keeping every edge shorter than nodeSpacing * K
+    float nodeSpacing = 0.5f;
+    // Strength of the pull of the cities on the nodes
+    float alpha = 0.2f;
+    // Strength of the tension between neighbouring nodes
+    float beta = 2.0f;
+    // K is annealed from initialK (unit square) down to finalK (city spacings),
+    // multiplied by decay every iteration
+    float initialK = 0.2f;
+    float finalK = 0.2f;
+    // The decay is lowered automatically if annealing would not fit into timeLimitSeconds
+    float decay = 0.98f;
+    // Converged once every city lies within tolerance of a node, or once the ring
+    // stops moving closer to the cities at finalK
+    float tolerance = 0.1f;
+    // Node weights below this fraction of a city's strongest weight are dropped
+    float weightCutoff = 1e-3f;
+    int maxIterations = 5000;
+    double timeLimitSeconds = 10.0;
+    // Checked every iteration, the run stops early once it is set
+    const std::atomic<bool>* stop = nullptr;
+    // Ranges the work is split into on the shared thread pool, 0 uses one per pool
+    // thread. Results are deterministic for a fixed value.
+    unsigned threads = 0;
+};
+
+struct ElasticNetResult {
+    Tour tour;
+    // Final ring positions in city coordinates
+    PointStore nodes;
+    int iterations = 0;
+    bool converged = false;
+    double seconds = 0.0;
+};
+
+// Run the elastic net on the cities. A ring of nodes starts as a small circle around
+// the centroid and is pulled iteratively towards the cities while K is annealed and
+// the ring is refined.
+// The tour visits cities in the order of their closest ring node. The run stops on
+// convergence, after maxIterations or once timeLimitSeconds has passed, whichever
+// comes first, and always returns a valid tour.
+ElasticNetResult solveElasticNet(const PointStore& cities, const ElasticNetOptions& options = ElasticNetOptions());
+
+#endif // ELASTICNET_H
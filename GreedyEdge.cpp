@@ -0,0 +1,93 @@
+#include "GreedyEdge.h"
+#include "DisjointSets.h"
+#include "PointGrid.h"
+#include "SpaceFillingCurve.h"
+#include "Trace.h"
+#include <array>
+
+namespace {
+
+constexpr PointId NONE = ~PointId{0};
+
+// Fragments joined between deadline checks
+constexpr std::size_t checkInterval = 1024;
+
+} // namespace
+
+Tour buildGreedyEdgeTour(const PointStore& cities, const NeighbourLists& neighbours, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("greedyEdgeTour");
+    const std::size_t count = cities.size();
+    Tour tour;
+    if (count == 0) {
+        return tour;
+    }
+    const std::vector<CandidateEdge> edges = sortedCandidateEdges(cities, neighbours, deadline);
+    if (edges.empty() && deadline.expired()) {
+        return buildCurveTour(cities);
+    }
+    tour.reserve(count);
+
+    // Up to two tour edges per city, NONE where there is none yet
+    std::vector<std::array<PointId, 2>> links(count, {NONE, NONE});
+    DisjointSets fragments(count);
+    for (const CandidateEdge& edge : edges) {
+        if (links[edge.a][1] != NONE || links[edge.b][1] != NONE || !fragments.unite(edge.a, edge.b)) {
+            continue;
+        }
+        links[edge.a][links[edge.a][0] == NONE ? 0 : 1] = edge.b;
+        links[edge.b][links[edge.b][0] == NONE ? 0 : 1] = edge.a;
+    }
+
+    // Every fragment is a path, a lone city being both of its ends
+    std::vector<PointId> ends;
+    for (std::size_t city = 0; city < count; ++city) {
+        if (links[city][1] == NONE) {
+            ends.push_back(static_cast<PointId>(city));
+        }
+    }
+    PointGrid freeEnds(cities, ends);
+
+    // Append the fragment starting at end to the tour and return its other end
+    auto appendFragment = [&](PointId end) {
+        freeEnds.remove(end);
+        PointId previous = NONE;
+        PointId current = end;
+        while (true) {
+            tour.push_back(current);
+            const std::array<PointId, 2>& next = links[current];
+            const PointId following = next[0] != previous ? next[0] : next[1];
+            if (following == NONE || following == previous) {
+                break;
+            }
+            previous = current;
+            current = following;
+        }
+        if (current != end) {
+            freeEnds.remove(current);
+        }
+        return current;
+    };
+
+    PointId last = appendFragment(ends.front());
+    for (std::size_t joined = 1; !freeEnds.empty(); ++joined) {
+        if (joined % checkInterval == 0 && deadline.expired()) {
+            for (PointId city : buildCurveTour(cities)) {
+                if (freeEnds.contains(city)) {
+                    appendFragment(city);
+                }
+            }
+            break;
+        }
+        const PointId next = static_cast<PointId>(freeEnds.nearest(cities.x(last), cities.y(last)));
+        last = appendFragment(next);
+    }
+    return tour;
+}
+
+Tour buildGreedyEdgeTour(const PointStore& cities, std::size_t neighbours, const Deadline& deadline) {
+    NeighbourLists lists;
+    if (!lists.build(cities, neighbours, deadline)) {
+        return buildCurveTour(cities);
+    }
+    return buildGreedyEdgeTour(cities, lists, deadline);
+}
@@ -0,0 +1,22 @@
+#ifndef GREEDYEDGE_H
+#define GREEDYEDGE_H
+
+#include "Deadline.h"
+#include "NeighbourLists.h"
+#include "PointStore.h"
+#include "Tour.h"
+#include <cstddef>
+
+// Greedy matching: take candidate edges shortest first, skipping those that would
+// give a city a third tour edge or close a cycle early, then join the path fragments
+// this leaves by walking from each fragment's end to the nearest free end of another.
+// O(n k log n) for the candidate lists and the edge sort, O(n k) memory. Tours are
+// typically 15-20% longer than optimal, and make a good start for 2-opt and
+// Lin-Kernighan since few of their edges are long. Once deadline expires the
+// fragments left are appended in curve order instead of nearest end first, or the
+// curve tour is returned if the candidates are not ready yet.
+Tour buildGreedyEdgeTour(const PointStore& cities, const NeighbourLists& neighbours,
+                         const Deadline& deadline = Deadline());
+Tour buildGreedyEdgeTour(const PointStore& cities, std::size_t neighbours = 10, const Deadline& deadline = Deadline());
+
+#endif // GREEDYEDGE_H
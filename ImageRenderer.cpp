@@ -0,0 +1,267 @@
+#include "ImageRenderer.h"
+#include "LineRasterizer.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#ifdef TSM_ZLIB
+#include <zlib.h>
+#endif
+
+namespace {
+
+// Fill the size x size square of every point that overlaps rows [top, bottom). Squares
+// start offset up and left of their point, truncated to whole pixels like SDL_Rect.
+void fillPoints(Image& image, int top, int bottom, const PointStore& points, int size, int offset, Rgba colour) {
+    const float* xs = points.xData();
+    const float* ys = points.yData();
+    const int width = image.getWidth();
+    // Loose float bounds first, they also reject NaN before any integer conversion
+    const float minX = static_cast<float>(offset - size - 1);
+    const float maxX = static_cast<float>(width + offset + 1);
+    const float minY = static_cast<float>(top + offset - size - 1);
+    const float maxY = static_cast<float>(bottom + offset + 1);
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        if (!(ys[i] > minY && ys[i] < maxY && xs[i] > minX && xs[i] < maxX)) {
+            continue;
+        }
+        const int x = static_cast<int>(xs[i]) - offset;
+        const int y = static_cast<int>(ys[i]) - offset;
+        const int left = std::max(x, 0);
+        const int right = std::min(x + size, width);
+        const int firstRow = std::max(y, top);
+        const int lastRow = std::min(y + size, bottom);
+        for (int row = firstRow; row < lastRow; ++row) {
+            std::fill(image.row(row) + left, image.row(row) + right, colour);
+        }
+    }
+}
+
+// Draw the closed polyline through (xs[i], ys[i]) where it crosses rows [top, bottom)
+void drawClosedPath(Image& image, int top, int bottom, const std::vector<float>& xs, const std::vector<float>& ys,
+                    Rgba colour) {
+    const std::size_t count = xs.size();
+    if (count < 2) {
+        return;
+    }
+    // A pixel wider than the band, a step's rounding may take it just past an endpoint
+    const float minY = static_cast<float>(top) - 1.0f;
+    const float maxY = static_cast<float>(bottom) + 1.0f;
+    for (std::size_t i = 0; i < count; ++i) {
+        const std::size_t j = i + 1 == count ? 0 : i + 1;
+        // Cheap rejection of edges entirely above or below the band
+        if (std::max(ys[i], ys[j]) < minY || std::min(ys[i], ys[j]) >= maxY) {
+            continue;
+        }
+        rasterizeLine(xs[i], ys[i], xs[j], ys[j], 0, top, image.getWidth(), bottom, [&](int x, int y) {
+            image.row(y)[x] = colour;
+        });
+    }
+}
+
+const std::array<std::uint32_t, 256>& crcTable() {
+    static const std::array<std::uint32_t, 256> table = [] {
+        std::array<std::uint32_t, 256> entries{};
+        for (std::uint32_t n = 0; n < 256; ++n) {
+            std::uint32_t c = n;
+            for (int bit = 0; bit < 8; ++bit) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            entries[n] = c;
+        }
+        return entries;
+    }();
+    return table;
+}
+
+std::uint32_t updateCrc(std::uint32_t crc, const std::uint8_t* data, std::size_t size) {
+    const std::array<std::uint32_t, 256>& table = crcTable();
+    for (std::size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return crc;
+}
+
+void appendBigEndian(std::vector<std::uint8_t>& out, std::uint32_t value) {
+    out.push_back(static_cast<std::uint8_t>(value >> 24));
+    out.push_back(static_cast<std::uint8_t>(value >> 16));
+    out.push_back(static_cast<std::uint8_t>(value >> 8));
+    out.push_back(static_cast<std::uint8_t>(value));
+}
+
+// Length, type, data and CRC of one PNG chunk
+bool writeChunk(std::FILE* file, const char* type, const std::vector<std::uint8_t>& data) {
+    std::vector<std::uint8_t> header;
+    appendBigEndian(header, static_cast<std::uint32_t>(data.size()));
+    header.insert(header.end(), type, type + 4);
+    std::uint32_t crc = updateCrc(0xFFFFFFFFu, header.data() + 4, 4);
+    crc = updateCrc(crc, data.data(), data.size()) ^ 0xFFFFFFFFu;
+    std::vector<std::uint8_t> trailer;
+    appendBigEndian(trailer, crc);
+    return std::fwrite(header.data(), 1, header.size(), file) == header.size() &&
+           std::fwrite(data.data(), 1, data.size(), file) == data.size() &&
+           std::fwrite(trailer.data(), 1, trailer.size(), file) == trailer.size();
+}
+
+// zlib stream of raw, deflated with zlib where available and in stored blocks otherwise
+std::vector<std::uint8_t> zlibStream(const std::vector<std::uint8_t>& raw) {
+#ifdef TSM_ZLIB
+    uLongf size = compressBound(static_cast<uLong>(raw.size()));
+    std::vector<std::uint8_t> deflated(size);
+    if (compress2(deflated.data(), &size, raw.data(), static_cast<uLong>(raw.size()), Z_BEST_SPEED) == Z_OK) {
+        deflated.resize(size);
+        return deflated;
+    }
+#endif
+    const std::size_t maxBlock = 65535;
+    std::vector<std::uint8_t> out;
+    out.reserve(raw.size() + raw.size() / maxBlock * 5 + 11);
+    out.push_back(0x78); // Deflate with a 32K window
+    out.push_back(0x01); // No preset dictionary, header check bits
+    std::size_t offset = 0;
+    do {
+        const std::size_t length = std::min(maxBlock, raw.size() - offset);
+        const bool last = offset + length == raw.size();
+        out.push_back(last ? 1 : 0);
+        out.push_back(static_cast<std::uint8_t>(length));
+        out.push_back(static_cast<std::uint8_t>(length >> 8));
+        out.push_back(static_cast<std::uint8_t>(~length));
+        out.push_back(static_cast<std::uint8_t>(~length >> 8));
+        out.insert(out.end(), raw.begin() + offset, raw.begin() + offset + length);
+        offset += length;
+    } while (offset < raw.size());
+
+    // Adler-32, reduced before the sums can overflow
+    std::uint32_t a = 1;
+    std::uint32_t b = 0;
+    for (std::size_t i = 0; i < raw.size(); ) {
+        const std::size_t end = std::min(raw.size(), i + 5552);
+        for (; i < end; ++i) {
+            a += raw[i];
+            b += a;
+        }
+        a %= 65521;
+        b %= 65521;
+    }
+    appendBigEndian(out, (b << 16) | a);
+    return out;
+}
+
+} // namespace
+
+Image renderImage(int width, int height, const PointStore& cities, const PointStore& net, const Tour& tour,
+                  const RenderStyle& style) {
+    // Every band scans all points and edges and keeps what crosses its rows. Two bands
+    // per thread balance uneven densities without multiplying that scan too often.
+    return renderImage(width, height, cities, net, tour, style, std::size_t{ThreadPool::shared().size()} * 2);
+}
+
+Image renderImage(int width, int height, const PointStore& cities, const PointStore& net, const Tour& tour,
+                  const RenderStyle& style, std::size_t bands) {
+    TSM_TRACE_SCOPE("renderImage");
+    Image image(std::max(width, 0), std::max(height, 0), style.background);
+    if (image.getWidth() == 0 || image.getHeight() == 0) {
+        return image;
+    }
+    ThreadPool& pool = ThreadPool::shared();
+
+    // Tour corners in visiting order, gathered once instead of by every band
+    std::vector<float> pathX(tour.size());
+    std::vector<float> pathY(tour.size());
+    pool.parallelFor(tour.size(), 1 << 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            pathX[i] = cities.x(tour[i]);
+            pathY[i] = cities.y(tour[i]);
+        }
+    });
+
+    pool.forEachChunk(static_cast<std::size_t>(image.getHeight()), std::max<std::size_t>(bands, 1),
+                      [&](std::size_t, std::size_t begin, std::size_t end) {
+        const int top = static_cast<int>(begin);
+        const int bottom = static_cast<int>(end);
+        fillPoints(image, top, bottom, cities, style.cityPointSize, 0, style.city);
+        fillPoints(image, top, bottom, net, style.netPointSize, style.netPointSize / 2, style.net);
+        drawClosedPath(image, top, bottom, pathX, pathY, style.tour);
+    });
+    return image;
+}
+
+bool writePpm(const char* path, const Image& image) {
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to write image " << path << std::endl;
+        return false;
+    }
+
+    std::fprintf(file, "P6\n%d %d\n255\n", image.getWidth(), image.getHeight());
+    std::vector<std::uint8_t> rgb(static_cast<std::size_t>(image.getWidth()) * 3);
+    bool written = true;
+    for (int y = 0; y < image.getHeight() && written; ++y) {
+        const Rgba* row = image.row(y);
+        for (int x = 0; x < image.getWidth(); ++x) {
+            rgb[3 * x] = row[x].r;
+            rgb[3 * x + 1] = row[x].g;
+            rgb[3 * x + 2] = row[x].b;
+        }
+        written = std::fwrite(rgb.data(), 1, rgb.size(), file) == rgb.size();
+    }
+
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::cerr << "Failed to write image " << path << std::endl;
+    }
+    return written;
+}
+
+bool writePng(const char* path, const Image& image) {
+    TSM_TRACE_SCOPE("writePng");
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to write image " << path << std::endl;
+        return false;
+    }
+
+    const int width = image.getWidth();
+    const int height = image.getHeight();
+    std::vector<std::uint8_t> header;
+    appendBigEndian(header, static_cast<std::uint32_t>(width));
+    appendBigEndian(header, static_cast<std::uint32_t>(height));
+    header.push_back(8); // Bits per channel
+    header.push_back(6); // RGBA
+    header.push_back(0); // Deflate
+    header.push_back(0); // Adaptive filtering
+    header.push_back(0); // Not interlaced
+
+    // Every scanline starts with its filter type, 0 leaves the bytes as they are
+    const std::size_t stride = static_cast<std::size_t>(width) * sizeof(Rgba);
+    std::vector<std::uint8_t> raw((stride + 1) * height);
+    ThreadPool::shared().parallelFor(static_cast<std::size_t>(height), 64, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t y = begin; y < end; ++y) {
+            raw[y * (stride + 1)] = 0;
+            std::memcpy(raw.data() + y * (stride + 1) + 1, image.row(static_cast<int>(y)), stride);
+        }
+    });
+
+    static const std::uint8_t signature[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n'};
+    bool written = std::fwrite(signature, 1, sizeof(signature), file) == sizeof(signature) &&
+                   writeChunk(file, "IHDR", header) &&
+                   writeChunk(file, "IDAT", zlibStream(raw)) &&
+                   writeChunk(file, "IEND", {});
+
+    written = std::fclose(file) == 0 && written;
+    if (!written) {
+        std::cerr << "Failed to write image " << path << std::endl;
+    }
+    return written;
+}
+
+bool writeImage(const char* path, const Image& image) {
+    const std::size_t length = std::strlen(path);
+    if (length >= 4 && std::strcmp(path + length - 4, ".png") == 0) {
+        return writePng(path, image);
+    }
+    return writePpm(path, image);
+}
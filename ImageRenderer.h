@@ -0,0 +1,70 @@
+#ifndef IMAGERENDERER_H
+#define IMAGERENDERER_H
+
+#include "PointStore.h"
+#include "Tour.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Software rendering of the layers the viewer draws, for machines without a display.
+// Nothing here touches SDL.
+
+struct Rgba {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+    std::uint8_t a;
+};
+
+// Row-major RGBA pixels, 4 bytes each in r, g, b, a order
+class Image {
+public:
+    Image() = default;
+    Image(int width, int height, Rgba fill)
+        : width(width), height(height), pixels(static_cast<std::size_t>(width) * height, fill) {}
+
+    int getWidth() const { return width; }
+    int getHeight() const { return height; }
+    Rgba* row(int y) { return pixels.data() + static_cast<std::size_t>(y) * width; }
+    const Rgba* row(int y) const { return pixels.data() + static_cast<std::size_t>(y) * width; }
+
+private:
+    int width = 0;
+    int height = 0;
+    std::vector<Rgba> pixels;
+};
+
+// Colours and point sizes, the defaults match SDLWindow
+struct RenderStyle {
+    int cityPointSize = 8;
+    int netPointSize = 5;
+    Rgba background{0x00, 0x00, 0x00, 0xFF};
+    Rgba city{0xFF, 0xFF, 0xFF, 0xFF};
+    Rgba net{0, 255, 0, 255};
+    Rgba tour{0xFF, 0x00, 0x00, 0xFF};
+};
+
+// Draw cities, net and the closed tour in that order, like SDLWindow::printPoints, in
+// screen coordinates. The image is split into two bands of rows per pool thread that
+// are drawn in parallel. Every band walks the tour edges crossing it with the same
+// steps as an unclipped walk, so the result does not depend on the thread count.
+// net and tour may be empty.
+Image renderImage(int width, int height, const PointStore& cities, const PointStore& net, const Tour& tour,
+                  const RenderStyle& style = RenderStyle());
+
+// Same, split into the given number of bands, for checking that any split gives the
+// same image
+Image renderImage(int width, int height, const PointStore& cities, const PointStore& net, const Tour& tour,
+                  const RenderStyle& style, std::size_t bands);
+
+// Binary PPM (P6), alpha is dropped
+bool writePpm(const char* path, const Image& image);
+
+// 8-bit RGBA PNG, compressed when built with zlib and stored uncompressed otherwise
+bool writePng(const char* path, const Image& image);
+
+// PNG if path ends in .png, PPM otherwise
+bool writeImage(const char* path, const Image& image);
+
+#endif // IMAGERENDERER_H
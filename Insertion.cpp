@@ -0,0 +1,232 @@
+#include "Insertion.h"
+#include "LocalSearch.h"
+#include "SpaceFillingCurve.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <limits>
+
+namespace {
+
+// Cities per chunk of the per-step scans. Small instances stay on the calling thread.
+constexpr std::size_t scanGrain = 1 << 14;
+
+// Best candidate of a scan, ties going to the lowest city
+struct Choice {
+    double value;
+    PointId city;
+};
+
+// Tour under construction: next[c] follows c, length[c] is the edge from c to next[c],
+// members lists the inserted cities
+struct PartialTour {
+    std::vector<PointId> next;
+    std::vector<double> length;
+    std::vector<PointId> members;
+};
+
+double squaredCityDistance(const PointStore& cities, std::size_t a, std::size_t b) {
+    double dx = static_cast<double>(cities.x(a)) - cities.x(b);
+    double dy = static_cast<double>(cities.y(a)) - cities.y(b);
+    return dx * dx + dy * dy;
+}
+
+// Extra length of putting city between a and next[a]
+double insertionCost(const PointStore& cities, const PartialTour& tour, PointId a, PointId city) {
+    return cityDistance(cities, a, city) + cityDistance(cities, city, tour.next[a]) - tour.length[a];
+}
+
+// Member after which inserting city costs least, ties going to the earliest member
+Choice cheapestEdge(const PointStore& cities, const PartialTour& tour, PointId city) {
+    Choice best{std::numeric_limits<double>::infinity(), 0};
+    for (PointId a : tour.members) {
+        const double cost = insertionCost(cities, tour, a, city);
+        if (cost < best.value) {
+            best = {cost, a};
+        }
+    }
+    return best;
+}
+
+void insertAfter(const PointStore& cities, PartialTour& tour, PointId a, PointId city) {
+    tour.next[city] = tour.next[a];
+    tour.next[a] = city;
+    tour.length[city] = cityDistance(cities, city, tour.next[city]);
+    tour.length[a] = cityDistance(cities, a, city);
+    tour.members.push_back(city);
+}
+
+Tour unroll(const PartialTour& tour) {
+    Tour order;
+    order.reserve(tour.members.size());
+    PointId city = tour.members.front();
+    do {
+        order.push_back(city);
+        city = tour.next[city];
+    } while (city != tour.members.front());
+    return order;
+}
+
+// b if it is strictly better than a, so ties keep the earlier chunk's choice
+Choice better(const Choice& a, const Choice& b, bool larger) {
+    if (larger ? b.value > a.value : b.value < a.value) {
+        return b;
+    }
+    return a;
+}
+
+void insertFarthest(const PointStore& cities, PartialTour& tour, std::vector<double>& gap, const Deadline& deadline) {
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t count = cities.size();
+    const double inserted = -1.0;
+    auto reduce = [](const Choice& a, const Choice& b) { return better(a, b, true); };
+    auto farthestOf = [&](std::size_t begin, std::size_t end) {
+        Choice choice{inserted, 0};
+        for (std::size_t city = begin; city < end; ++city) {
+            if (gap[city] > choice.value) {
+                choice = {gap[city], static_cast<PointId>(city)};
+            }
+        }
+        return choice;
+    };
+
+    Choice choice = pool.parallelReduce(count, scanGrain, Choice{inserted, 0}, farthestOf, reduce);
+    while (choice.value != inserted && !deadline.expired()) {
+        const PointId city = choice.city;
+        insertAfter(cities, tour, cheapestEdge(cities, tour, city).city, city);
+        gap[city] = inserted;
+        choice = pool.parallelReduce(
+            count, scanGrain, Choice{inserted, 0},
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t other = begin; other < end; ++other) {
+                    if (gap[other] != inserted) {
+                        gap[other] = std::min(gap[other], squaredCityDistance(cities, other, city));
+                    }
+                }
+                return farthestOf(begin, end);
+            },
+            reduce);
+    }
+}
+
+void insertCheapest(const PointStore& cities, PartialTour& tour, const Deadline& deadline) {
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t count = cities.size();
+    const double inserted = std::numeric_limits<double>::infinity();
+    // Cheapest insertion of every city left and the member it would follow. Every
+    // other edge costs at least as much. Once that edge is split the entry goes
+    // stale: its value is only a lower bound then, and the city searches all edges
+    // again only when that bound is the cheapest of all, which is rarely.
+    std::vector<Choice> best(count);
+    std::vector<char> stale(count, 0);
+    pool.parallelFor(count, scanGrain, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t city = begin; city < end; ++city) {
+            best[city] = cheapestEdge(cities, tour, static_cast<PointId>(city));
+        }
+    });
+    for (PointId member : tour.members) {
+        best[member].value = inserted;
+    }
+
+    auto reduce = [](const Choice& a, const Choice& b) { return better(a, b, false); };
+    auto cheapestOf = [&](std::size_t begin, std::size_t end) {
+        Choice choice{inserted, 0};
+        for (std::size_t city = begin; city < end; ++city) {
+            if (best[city].value < choice.value) {
+                choice = {best[city].value, static_cast<PointId>(city)};
+            }
+        }
+        return choice;
+    };
+
+    Choice choice = pool.parallelReduce(count, scanGrain, Choice{inserted, 0}, cheapestOf, reduce);
+    while (choice.value != inserted && !deadline.expired()) {
+        const PointId city = choice.city;
+        if (stale[city]) {
+            best[city] = cheapestEdge(cities, tour, city);
+            stale[city] = 0;
+            choice = pool.parallelReduce(count, scanGrain, Choice{inserted, 0}, cheapestOf, reduce);
+            continue;
+        }
+        const PointId a = best[city].city;
+        insertAfter(cities, tour, a, city);
+        best[city].value = inserted;
+
+        // Edge a-b became a-city and city-b
+        choice = pool.parallelReduce(
+            count, scanGrain, Choice{inserted, 0},
+            [&](std::size_t begin, std::size_t end) {
+                for (std::size_t other = begin; other < end; ++other) {
+                    Choice& current = best[other];
+                    if (current.value == inserted) {
+                        continue;
+                    }
+                    const PointId id = static_cast<PointId>(other);
+                    if (current.city == a) {
+                        stale[other] = 1;
+                    }
+                    const double afterA = insertionCost(cities, tour, a, id);
+                    const double afterCity = insertionCost(cities, tour, city, id);
+                    if (afterA <= current.value) {
+                        current = {afterA, a};
+                        stale[other] = 0;
+                    }
+                    if (afterCity < current.value || (stale[other] && afterCity == current.value)) {
+                        current = {afterCity, city};
+                        stale[other] = 0;
+                    }
+                }
+                return cheapestOf(begin, end);
+            },
+            reduce);
+    }
+}
+
+} // namespace
+
+Tour buildInsertionTour(const PointStore& cities, InsertionRule rule, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("insertionTour");
+    const std::size_t count = cities.size();
+    Tour order;
+    if (count <= 3) {
+        for (std::size_t city = 0; city < count; ++city) {
+            order.push_back(static_cast<PointId>(city));
+        }
+        return order;
+    }
+
+    // Start from city 0 and the city farthest from it, a tour of two edges. gap holds
+    // every city's squared distance to the tour, -1 once it is part of it.
+    std::vector<double> gap(count);
+    PointId far = 0;
+    for (std::size_t city = 0; city < count; ++city) {
+        gap[city] = squaredCityDistance(cities, 0, city);
+        if (gap[city] > gap[far]) {
+            far = static_cast<PointId>(city);
+        }
+    }
+    if (far == 0) {
+        far = 1;
+    }
+
+    PartialTour tour;
+    tour.next.resize(count);
+    tour.length.resize(count);
+    tour.next[0] = far;
+    tour.next[far] = 0;
+    tour.length[0] = tour.length[far] = cityDistance(cities, 0, far);
+    tour.members = {0, far};
+
+    if (rule == InsertionRule::Farthest) {
+        for (std::size_t city = 0; city < count; ++city) {
+            gap[city] = std::min(gap[city], squaredCityDistance(cities, far, city));
+        }
+        gap[0] = -1.0;
+        gap[far] = -1.0;
+        insertFarthest(cities, tour, gap, deadline);
+    } else {
+        insertCheapest(cities, tour, deadline);
+    }
+    order = unroll(tour);
+    appendAlongCurve(cities, order);
+    return order;
+}
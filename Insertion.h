@@ -0,0 +1,24 @@
+#ifndef INSERTION_H
+#define INSERTION_H
+
+#include "Deadline.h"
+#include "PointStore.h"
+#include "Tour.h"
+
+enum class InsertionRule {
+    // Insert the city farthest from the tour, where it lengthens the tour least.
+    // Sketches the outline first and fills it in, typically 10-15% above optimal.
+    Farthest,
+    // Insert the city that lengthens the tour least, typically about 20% above optimal
+    Cheapest
+};
+
+// Grow a tour from the first city and the city farthest from it by inserting the
+// remaining cities one at a time. O(n^2) time for Farthest, O(n^2) expected for
+// Cheapest, both O(n) memory: about a second for 10^4 cities on one core. The
+// per-step scans over all cities run on the shared thread pool, with results that do
+// not depend on the thread count. Once deadline expires the cities left are appended
+// along a curve.
+Tour buildInsertionTour(const PointStore& cities, InsertionRule rule, const Deadline& deadline = Deadline());
+
+#endif // INSERTION_H
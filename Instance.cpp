@@ -0,0 +1,56 @@
+#include "Instance.h"
+#include "Trace.h"
+#include <algorithm>
+#include <random>
+
+PointStore createPoints(int numberOfPoints, double width, double height,
+                        unsigned seed, double coverPercentage) {
+    TSM_TRACE_SCOPE("createPoints");
+    PointStore cities;
+    if (numberOfPoints <= 0) {
+        return cities;
+    }
+
+    std::mt19937 generator(seed);
+    std::uniform_real_distribution<double> randomX(0.0, width * coverPercentage);
+    std::uniform_real_distribution<double> randomY(0.0, height * coverPercentage);
+
+    cities.reserve(static_cast<std::size_t>(numberOfPoints));
+    for (int i = 0; i < numberOfPoints; ++i) {
+        double x = randomX(generator);
+        double y = randomY(generator);
+        cities.add(static_cast<float>(x), static_cast<float>(y));
+    }
+
+    return cities;
+}
+
+void fitToArea(PointStore& cities, double width, double height, double coverPercentage) {
+    if (cities.empty()) {
+        return;
+    }
+
+    float minX = cities.x(0);
+    float maxX = minX;
+    float minY = cities.y(0);
+    float maxY = minY;
+    for (std::size_t i = 1; i < cities.size(); ++i) {
+        minX = std::min(minX, cities.x(i));
+        maxX = std::max(maxX, cities.x(i));
+        minY = std::min(minY, cities.y(i));
+        maxY = std::max(maxY, cities.y(i));
+    }
+
+    double spanX = static_cast<double>(maxX) - minX;
+    double spanY = static_cast<double>(maxY) - minY;
+    double scaleX = spanX > 0.0 ? width * coverPercentage / spanX : 1.0;
+    double scaleY = spanY > 0.0 ? height * coverPercentage / spanY : 1.0;
+    double scale = std::min(scaleX, scaleY);
+
+    float* xs = cities.xData();
+    float* ys = cities.yData();
+    for (std::size_t i = 0; i < cities.size(); ++i) {
+        xs[i] = static_cast<float>((xs[i] - minX) * scale);
+        ys[i] = static_cast<float>((ys[i] - minY) * scale);
+    }
+}
@@ -0,0 +1,16 @@
+#ifndef INSTANCE_H
+#define INSTANCE_H
+
+#include "PointStore.h"
+
+// Generate numberOfPoints uniformly distributed cities inside a width x height area.
+// Only coverPercentage of each side is used so points stay clear of the far border.
+PointStore createPoints(int numberOfPoints, double width, double height,
+                        unsigned seed, double coverPercentage = 0.99);
+
+// Scale and shift cities uniformly so they fill the same part of a width x height area
+// that createPoints uses, keeping the aspect ratio. Relative distances, and so the
+// optimal tour, do not change.
+void fitToArea(PointStore& cities, double width, double height, double coverPercentage = 0.99);
+
+#endif // INSTANCE_H
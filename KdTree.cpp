@@ -0,0 +1,180 @@
+#include "KdTree.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+void KdTree::build(const PointStore& points) {
+    std::vector<PointId> order(points.size());
+    std::iota(order.begin(), order.end(), PointId{0});
+
+    axes.assign(points.size(), 0);
+    buildRange(order, points, 0, points.size());
+
+    xs.resize(points.size());
+    ys.resize(points.size());
+    ids = std::move(order);
+    for (std::size_t i = 0; i < ids.size(); ++i) {
+        xs[i] = points.x(ids[i]);
+        ys[i] = points.y(ids[i]);
+    }
+}
+
+void KdTree::buildRange(std::vector<PointId>& order, const PointStore& points,
+                        std::size_t lo, std::size_t hi) {
+    if (hi - lo <= LEAF_SIZE) {
+        return;
+    }
+
+    // Split along the axis with the larger extent
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+    for (std::size_t i = lo; i < hi; ++i) {
+        float x = points.x(order[i]);
+        float y = points.y(order[i]);
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+    }
+    const std::uint8_t axis = (maxY - minY) > (maxX - minX) ? 1 : 0;
+
+    const std::size_t mid = lo + (hi - lo) / 2;
+    const float* coordinates = axis == 0 ? points.xData() : points.yData();
+    std::nth_element(order.begin() + lo, order.begin() + mid, order.begin() + hi,
+                     [&](PointId a, PointId b) { return coordinates[a] < coordinates[b]; });
+    axes[mid] = axis;
+
+    buildRange(order, points, lo, mid);
+    buildRange(order, points, mid + 1, hi);
+}
+
+std::size_t KdTree::nearest(const Vector<2>& query) const {
+    return nearest(query[0], query[1]);
+}
+
+std::size_t KdTree::nearest(float qx, float qy) const {
+    std::size_t best = ids.size();
+    float bestDistance = std::numeric_limits<float>::max();
+    searchNearest(qx, qy, 0, ids.size(), best, bestDistance);
+    return best < ids.size() ? ids[best] : ids.size();
+}
+
+void KdTree::searchNearest(float qx, float qy, std::size_t lo, std::size_t hi,
+                           std::size_t& best, float& bestDistance) const {
+    if (hi - lo <= LEAF_SIZE) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            float dx = xs[i] - qx;
+            float dy = ys[i] - qy;
+            float distance = dx * dx + dy * dy;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = i;
+            }
+        }
+        return;
+    }
+
+    const std::size_t mid = lo + (hi - lo) / 2;
+    float dx = xs[mid] - qx;
+    float dy = ys[mid] - qy;
+    float distance = dx * dx + dy * dy;
+    if (distance < bestDistance) {
+        bestDistance = distance;
+        best = mid;
+    }
+
+    // Descend into the side containing the query first, then the other side
+    // only if the splitting line is closer than the best match so far
+    float split = axes[mid] == 0 ? qx - xs[mid] : qy - ys[mid];
+    if (split < 0) {
+        searchNearest(qx, qy, lo, mid, best, bestDistance);
+        if (split * split < bestDistance) {
+            searchNearest(qx, qy, mid + 1, hi, best, bestDistance);
+        }
+    } else {
+        searchNearest(qx, qy, mid + 1, hi, best, bestDistance);
+        if (split * split < bestDistance) {
+            searchNearest(qx, qy, lo, mid, best, bestDistance);
+        }
+    }
+}
+
+void KdTree::kNearest(const Vector<2>& query, std::size_t k, std::vector<PointId>& out) const {
+    out.clear();
+    if (k == 0 || ids.empty()) {
+        return;
+    }
+
+    std::vector<Neighbour> heap;
+    heap.reserve(std::min(k, ids.size()));
+    searchKNearest(query[0], query[1], 0, ids.size(), k, heap);
+
+    std::sort_heap(heap.begin(), heap.end(), [](const Neighbour& a, const Neighbour& b) {
+        return a.distance < b.distance;
+    });
+    for (const Neighbour& neighbour : heap) {
+        out.push_back(ids[neighbour.position]);
+    }
+}
+
+std::vector<PointId> KdTree::kNearest(const Vector<2>& query, std::size_t k) const {
+    std::vector<PointId> result;
+    kNearest(query, k, result);
+    return result;
+}
+
+void KdTree::offer(float qx, float qy, std::size_t position, std::size_t k,
+                   std::vector<Neighbour>& heap) const {
+    auto farther = [](const Neighbour& a, const Neighbour& b) { return a.distance < b.distance; };
+
+    float dx = xs[position] - qx;
+    float dy = ys[position] - qy;
+    float distance = dx * dx + dy * dy;
+    if (heap.size() < k) {
+        heap.push_back({distance, position});
+        std::push_heap(heap.begin(), heap.end(), farther);
+    } else if (distance < heap.front().distance) {
+        std::pop_heap(heap.begin(), heap.end(), farther);
+        heap.back() = {distance, position};
+        std::push_heap(heap.begin(), heap.end(), farther);
+    }
+}
+
+void KdTree::searchKNearest(float qx, float qy, std::size_t lo, std::size_t hi, std::size_t k,
+                            std::vector<Neighbour>& heap) const {
+    if (hi - lo <= LEAF_SIZE) {
+        for (std::size_t i = lo; i < hi; ++i) {
+            offer(qx, qy, i, k, heap);
+        }
+        return;
+    }
+
+    const std::size_t mid = lo + (hi - lo) / 2;
+    offer(qx, qy, mid, k, heap);
+
+    float split = axes[mid] == 0 ? qx - xs[mid] : qy - ys[mid];
+    std::size_t nearLo = split < 0 ? lo : mid + 1;
+    std::size_t nearHi = split < 0 ? mid : hi;
+    std::size_t farLo = split < 0 ? mid + 1 : lo;
+    std::size_t farHi = split < 0 ? hi : mid;
+
+    searchKNearest(qx, qy, nearLo, nearHi, k, heap);
+    if (heap.size() < k || split * split < heap.front().distance) {
+        searchKNearest(qx, qy, farLo, farHi, k, heap);
+    }
+}
+
+std::vector<PointId> KdTree::nearestAll(const PointStore& queries) const {
+    std::vector<PointId> result(queries.size(), static_cast<PointId>(ids.size()));
+    const float* qx = queries.xData();
+    const float* qy = queries.yData();
+    ThreadPool::shared().parallelFor(queries.size(), 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            result[i] = static_cast<PointId>(nearest(qx[i], qy[i]));
+        }
+    });
+    return result;
+}
@@ -0,0 +1,65 @@
+#ifndef KDTREE_H
+#define KDTREE_H
+
+#include "PointStore.h"
+#include "Vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Static 2-D k-d tree over a fixed point set.
+// The tree is implicit: points are stored in flat arrays permuted so that every
+// range [lo, hi) has its splitting point at (lo + hi) / 2, so no node pointers
+// are needed. Query results are indices into the point list passed to build().
+class KdTree {
+public:
+    KdTree() = default;
+    explicit KdTree(const PointStore& points) { build(points); }
+
+    // Rebuild the tree over points. O(n log n).
+    void build(const PointStore& points);
+
+    bool empty() const { return ids.empty(); }
+    std::size_t size() const { return ids.size(); }
+    // Point stored at a position of the tree. Consecutive positions are spatially close,
+    // so queries issued in position order mostly touch the same nodes.
+    PointId idAt(std::size_t position) const { return ids[position]; }
+
+    // Index of the point closest to query, or size() if the tree is empty.
+    std::size_t nearest(const Vector<2>& query) const;
+
+    // Up to k indices closest to query, ordered by increasing distance.
+    // Clears and reuses out so repeated queries do not allocate.
+    void kNearest(const Vector<2>& query, std::size_t k, std::vector<PointId>& out) const;
+    std::vector<PointId> kNearest(const Vector<2>& query, std::size_t k) const;
+
+    // nearest() for every query, result[i] belongs to queries[i].
+    std::vector<PointId> nearestAll(const PointStore& queries) const;
+
+private:
+    // Ranges at or below this size are scanned linearly instead of split further.
+    static constexpr std::size_t LEAF_SIZE = 8;
+
+    struct Neighbour {
+        float distance;
+        std::size_t position;
+    };
+
+    void buildRange(std::vector<PointId>& order, const PointStore& points,
+                    std::size_t lo, std::size_t hi);
+    std::size_t nearest(float qx, float qy) const;
+    void searchNearest(float qx, float qy, std::size_t lo, std::size_t hi,
+                       std::size_t& best, float& bestDistance) const;
+    void searchKNearest(float qx, float qy, std::size_t lo, std::size_t hi, std::size_t k,
+                        std::vector<Neighbour>& heap) const;
+    void offer(float qx, float qy, std::size_t position, std::size_t k,
+               std::vector<Neighbour>& heap) const;
+
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<PointId> ids;
+    // Split axis (0 = x, 1 = y) of the node stored at each position
+    std::vector<std::uint8_t> axes;
+};
+
+#endif // KDTREE_H
@@ -0,0 +1,79 @@
+// Microbenchmark for the distance kernels: times every instruction set level the
+// CPU supports against the scalar fallback.
+
+#include "DistanceKernels.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main() {
+    const std::size_t sizes[] = {64, 1024, 16384, 262144};
+    const SimdLevel levels[] = {SimdLevel::Scalar, SimdLevel::SSE2, SimdLevel::AVX2, SimdLevel::AVX512};
+    const SimdLevel supported = detectSimdLevel();
+
+    std::printf("detected: %s\n", simdLevelName(supported));
+    std::printf("%-8s %10s %14s %14s %10s\n", "kernel", "points", "level", "ns/point", "speedup");
+
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<float> coordinate(0.0f, 1000.0f);
+
+    for (std::size_t size : sizes) {
+        std::vector<float> xs(size);
+        std::vector<float> ys(size);
+        for (std::size_t i = 0; i < size; ++i) {
+            xs[i] = coordinate(generator);
+            ys[i] = coordinate(generator);
+        }
+
+        // Keep the total work per measurement roughly constant
+        const std::size_t repetitions = std::max<std::size_t>(1, (std::size_t{1} << 26) / size);
+        double scalarNearest = 0.0;
+        double scalarSum = 0.0;
+
+        for (SimdLevel level : levels) {
+            if (level > supported) {
+                continue;
+            }
+            const DistanceKernels& kernels = getDistanceKernels(level);
+
+            volatile std::size_t sink = 0;
+            auto start = std::chrono::steady_clock::now();
+            for (std::size_t r = 0; r < repetitions; ++r) {
+                float bestSquaredDistance;
+                sink = sink + kernels.nearest(xs[r % size], ys[r % size], xs.data(), ys.data(), size,
+                                              bestSquaredDistance);
+            }
+            double nearestSeconds = secondsSince(start);
+
+            volatile double total = 0.0;
+            start = std::chrono::steady_clock::now();
+            for (std::size_t r = 0; r < repetitions; ++r) {
+                total = total + kernels.sum(xs.data(), size);
+            }
+            double sumSeconds = secondsSince(start);
+
+            if (level == SimdLevel::Scalar) {
+                scalarNearest = nearestSeconds;
+                scalarSum = sumSeconds;
+            }
+
+            double points = static_cast<double>(repetitions) * static_cast<double>(size);
+            std::printf("%-8s %10zu %14s %14.3f %9.2fx\n", "nearest", size, simdLevelName(level),
+                        nearestSeconds * 1e9 / points, scalarNearest / nearestSeconds);
+            std::printf("%-8s %10zu %14s %14.3f %9.2fx\n", "sum", size, simdLevelName(level),
+                        sumSeconds * 1e9 / points, scalarSum / sumSeconds);
+        }
+    }
+
+    return 0;
+}
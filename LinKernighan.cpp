@@ -0,0 +1,293 @@
+#include "LinKernighan.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <deque>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Gains smaller than this are treated as rounding noise
+constexpr double MIN_GAIN = 1e-7;
+// Alternatives tried at the first levels of a move before going greedy
+constexpr int BREADTH[] = {5, 3};
+
+// Replace tour edges (a, b) and (c, d) with (a, c) and (b, d). Both edges must run
+// the same way round the tour, i.e. b follows a exactly when d follows c.
+struct Exchange {
+    std::size_t a, b, c, d;
+};
+
+// One candidate step from the current end of the chain
+struct Step {
+    double gain;
+    int kind;
+    std::size_t t3, t4, t5, t6;
+};
+
+enum StepKind {
+    // t4 precedes t3: a 2-opt flip
+    Flip,
+    // t4 follows t3, t6 follows t5: the two segments swap places
+    SwapSegments,
+    // t4 follows t3, t6 precedes t5: both segments are reversed in place
+    ReverseSegments
+};
+
+class Search {
+public:
+    Search(const PointStore& cities, const NeighbourLists& neighbours, const Tour& tour, int maxDepth)
+        : cities(cities), neighbours(neighbours), array(tour), maxDepth(maxDepth), steps(maxDepth) {}
+
+    // Look for an improving move starting with the removal of tour edge (t1, t2).
+    // On success the move is applied and the touched cities are passed to touched.
+    template <typename Touched>
+    bool improve(std::size_t first, std::size_t second, double& gain, Touched touched) {
+        t1 = first;
+        bestGain = MIN_GAIN;
+        bestLength = 0;
+        exchanges.clear();
+        added.clear();
+
+        extend(0, second, distance(t1, second));
+        if (bestLength == 0) {
+            return false;
+        }
+        undoTo(bestLength);
+        for (const Exchange& e : exchanges) {
+            touched(e.a);
+            touched(e.b);
+            touched(e.c);
+            touched(e.d);
+        }
+        gain = bestGain;
+        return true;
+    }
+
+    const ArrayTour& getTour() const { return array; }
+
+private:
+    double distance(std::size_t a, std::size_t b) const { return cityDistance(cities, a, b); }
+
+    std::size_t succ(std::size_t city) const { return forward ? array.next(city) : array.prev(city); }
+    std::size_t pred(std::size_t city) const { return forward ? array.prev(city) : array.next(city); }
+    bool onPath(std::size_t from, std::size_t city, std::size_t to) const {
+        return forward ? array.between(from, city, to) : array.between(to, city, from);
+    }
+
+    bool isAdded(std::size_t a, std::size_t b) const {
+        for (const auto& edge : added) {
+            if ((edge.first == a && edge.second == b) || (edge.first == b && edge.second == a)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void exchange(std::size_t a, std::size_t b, std::size_t c, std::size_t d) {
+        apply(a, b, c, d);
+        exchanges.push_back({a, b, c, d});
+    }
+
+    void apply(std::size_t a, std::size_t b, std::size_t c, std::size_t d) {
+        if (array.next(a) == b) {
+            array.reverse(b, c);
+        } else {
+            array.reverse(a, d);
+        }
+    }
+
+    void undoTo(std::size_t length) {
+        while (exchanges.size() > length) {
+            const Exchange e = exchanges.back();
+            exchanges.pop_back();
+            apply(e.a, e.c, e.b, e.d);
+        }
+    }
+
+    // Collect the steps that keep the partial gain positive, best first
+    void collectSteps(std::vector<Step>& out, std::size_t t2, double gain) {
+        out.clear();
+        for (const PointId* it3 = neighbours.begin(t2); it3 != neighbours.end(t2); ++it3) {
+            const std::size_t t3 = *it3;
+            const double g1 = gain - distance(t2, t3);
+            if (g1 <= 0.0) {
+                break;
+            }
+            if (t3 == t1 || t3 == succ(t2)) {
+                continue;
+            }
+
+            const std::size_t before = pred(t3);
+            if (!isAdded(before, t3)) {
+                out.push_back({g1 + distance(before, t3), Flip, t3, before, 0, 0});
+            }
+
+            // Removing (t3, succ(t3)) splits off the cycle t2 .. t3, the third exchange
+            // reconnects it through t5 inside that cycle
+            const std::size_t t4 = succ(t3);
+            if (t4 == t1 || isAdded(t3, t4)) {
+                continue;
+            }
+            const double g1Open = g1 + distance(t3, t4);
+            for (const PointId* it5 = neighbours.begin(t4); it5 != neighbours.end(t4); ++it5) {
+                const std::size_t t5 = *it5;
+                const double g2 = g1Open - distance(t4, t5);
+                if (g2 <= 0.0) {
+                    break;
+                }
+                if (t5 == t3 || !onPath(t2, t5, t3)) {
+                    continue;
+                }
+                const std::size_t after = succ(t5);
+                if (!isAdded(t5, after)) {
+                    out.push_back({g2 + distance(t5, after), SwapSegments, t3, t4, t5, after});
+                }
+                const std::size_t previous = pred(t5);
+                if (t5 != t2 && previous != t2 && !isAdded(previous, t5)) {
+                    out.push_back({g2 + distance(previous, t5), ReverseSegments, t3, t4, t5, previous});
+                }
+            }
+        }
+        std::sort(out.begin(), out.end(), [](const Step& a, const Step& b) { return a.gain > b.gain; });
+    }
+
+    // The chain so far removed tour edge (t1, t2) last, gain is its total before closing
+    void extend(int depth, std::size_t t2, double gain) {
+        if (depth >= maxDepth) {
+            return;
+        }
+        forward = array.next(t1) == t2;
+        std::vector<Step>& candidates = steps[depth];
+        collectSteps(candidates, t2, gain);
+
+        const std::size_t breadth = depth < 2 ? BREADTH[depth] : 1;
+        const std::size_t tried = std::min(breadth, candidates.size());
+        for (std::size_t i = 0; i < tried; ++i) {
+            const Step step = candidates[i];
+            const std::size_t end = step.kind == Flip ? step.t4 : step.t6;
+            const double closed = step.gain - distance(end, t1);
+            const bool improves = closed > bestGain;
+            // The next step needs an edge from end shorter than the gain so far
+            const bool deeper = depth + 1 < maxDepth && neighbours.perCity() > 0 &&
+                                step.gain > distance(end, *neighbours.begin(end));
+            if (!improves && !deeper) {
+                continue;
+            }
+
+            const std::size_t mark = exchanges.size();
+            const std::size_t addedMark = added.size();
+            forward = array.next(t1) == t2;
+            added.emplace_back(t2, step.t3);
+            if (step.kind == Flip) {
+                exchange(t1, t2, step.t4, step.t3);
+            } else if (step.kind == SwapSegments) {
+                added.emplace_back(step.t4, step.t5);
+                exchange(t1, t2, step.t5, step.t6);
+                exchange(t1, step.t5, step.t3, step.t4);
+                exchange(t1, step.t3, step.t6, t2);
+            } else {
+                added.emplace_back(step.t4, step.t5);
+                exchange(t1, t2, step.t6, step.t5);
+                exchange(t2, step.t5, step.t3, step.t4);
+            }
+
+            if (improves) {
+                bestGain = closed;
+                bestLength = exchanges.size();
+            }
+            if (deeper) {
+                extend(depth + 1, end, step.gain);
+            }
+            // Stop backtracking once anything improves, the caller trims the chain
+            if (bestLength > 0) {
+                return;
+            }
+            undoTo(mark);
+            added.resize(addedMark);
+        }
+    }
+
+    const PointStore& cities;
+    const NeighbourLists& neighbours;
+    ArrayTour array;
+    int maxDepth;
+    std::vector<std::vector<Step>> steps;
+    std::vector<Exchange> exchanges;
+    std::vector<std::pair<std::size_t, std::size_t>> added;
+    std::size_t t1 = 0;
+    bool forward = true;
+    double bestGain = 0.0;
+    std::size_t bestLength = 0;
+};
+
+} // namespace
+
+ImprovementReport improveLinKernighan(const PointStore& cities, Tour& tour, const LinKernighanOptions& options) {
+    NeighbourLists neighbours(cities, options.neighbours);
+    return improveLinKernighan(cities, tour, neighbours, options);
+}
+
+ImprovementReport improveLinKernighan(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                      const LinKernighanOptions& options) {
+    TSM_TRACE_SCOPE("linKernighan");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ImprovementReport report;
+    report.initialLength = tourLength(cities, tour);
+    report.finalLength = report.initialLength;
+    const std::size_t n = tour.size();
+    if (n < 8 || options.maxDepth < 1) {
+        return report;
+    }
+
+    Search search(cities, neighbours, tour, options.maxDepth);
+    std::vector<char> queued(n, 1);
+    std::deque<std::size_t> queue(tour.begin(), tour.end());
+    auto activate = [&](std::size_t city) {
+        if (!queued[city]) {
+            queued[city] = 1;
+            queue.push_back(city);
+        }
+    };
+
+    double length = report.initialLength;
+    double lastProgress = 0.0;
+    std::size_t reportedMoves = 0;
+    std::size_t steps = 0;
+    while (!queue.empty()) {
+        if ((++steps & 15) == 0) {
+            const double seconds = elapsed();
+            if (seconds > options.timeLimitSeconds ||
+                (options.stop != nullptr && options.stop->load(std::memory_order_relaxed))) {
+                break;
+            }
+            if (options.progress && report.moves != reportedMoves && seconds - lastProgress >= options.progressSeconds) {
+                lastProgress = seconds;
+                reportedMoves = report.moves;
+                options.progress(search.getTour().getOrder(), length);
+            }
+        }
+        const std::size_t t1 = queue.front();
+        queue.pop_front();
+        queued[t1] = 0;
+
+        double gain = 0.0;
+        const ArrayTour& array = search.getTour();
+        if (search.improve(t1, array.next(t1), gain, activate) ||
+            search.improve(t1, array.prev(t1), gain, activate)) {
+            length -= gain;
+            ++report.moves;
+            activate(t1);
+        }
+    }
+
+    tour = search.getTour().getOrder();
+    report.finalLength = tourLength(cities, tour);
+    report.seconds = elapsed();
+    return report;
+}
@@ -0,0 +1,38 @@
+#ifndef LINKERNIGHAN_H
+#define LINKERNIGHAN_H
+
+#include "LocalSearch.h"
+#include "NeighbourLists.h"
+#include "PointStore.h"
+#include "Tour.h"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+struct LinKernighanOptions {
+    // Candidate neighbours per city
+    std::size_t neighbours = 5;
+    // Maximum number of sequential 3-opt steps in one move
+    int maxDepth = 50;
+    double timeLimitSeconds = std::numeric_limits<double>::infinity();
+    // Checked along with the time limit, the search stops early once it is set
+    const std::atomic<bool>* stop = nullptr;
+    // Called with the improved tour at most every progressSeconds while the search runs
+    ImprovementCallback progress;
+    double progressSeconds = 0.05;
+};
+
+// Variable-depth Lin-Kernighan improvement in the Or-opt style: each step of a move is
+// a sequential 3-opt exchange (which includes plain 2-opt steps and segment insertions
+// that a chain of 2-opt flips cannot reach), steps are chained while the partial gain
+// stays positive, and the best closed tour along the chain is kept. The first levels
+// backtrack over several candidates (5, then 3), deeper levels go greedy.
+// Best started from an already 2-opted tour, see Solver.
+ImprovementReport improveLinKernighan(const PointStore& cities, Tour& tour,
+                                      const LinKernighanOptions& options = LinKernighanOptions());
+
+// Same, reusing candidate lists that were already built over cities.
+ImprovementReport improveLinKernighan(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                      const LinKernighanOptions& options = LinKernighanOptions());
+
+#endif // LINKERNIGHAN_H
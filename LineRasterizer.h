@@ -0,0 +1,71 @@
+#ifndef LINERASTERIZER_H
+#define LINERASTERIZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+// Call plot(x, y) for every pixel of the segment from (x0, y0) to (x1, y1) inside the
+// clip rectangle [left, right) x [top, bottom). The segment is walked one pixel per
+// step along its longer axis, always from (x0, y0) with the same steps, and only the
+// steps inside the rectangle are visited. A pixel is therefore plotted the same way
+// whatever rectangle it is clipped to, so rectangles that tile an image, like bands
+// drawn in parallel, together plot exactly the pixels of one unclipped walk.
+template <typename Plot>
+void rasterizeLine(float x0, float y0, float x1, float y1, int left, int top, int right, int bottom, Plot&& plot) {
+    if (left >= right || top >= bottom) {
+        return;
+    }
+    const float dx = x1 - x0;
+    const float dy = y1 - y0;
+    if (!std::isfinite(dx) || !std::isfinite(dy)) {
+        return;
+    }
+
+    // Liang-Barsky: keep the parameter range [t0, t1] where p * t <= q for every edge.
+    // The rectangle is widened by a pixel so rounding in t cannot lose a step inside it,
+    // the steps themselves are tested exactly below.
+    float t0 = 0.0f;
+    float t1 = 1.0f;
+    auto clip = [&t0, &t1](float p, float q) {
+        if (p == 0.0f) {
+            return q >= 0.0f;
+        }
+        float t = q / p;
+        if (p < 0.0f) {
+            t0 = std::max(t0, t);
+        } else {
+            t1 = std::min(t1, t);
+        }
+        return t0 <= t1;
+    };
+    const float minX = static_cast<float>(left) - 1.0f;
+    const float maxX = static_cast<float>(right) + 1.0f;
+    const float minY = static_cast<float>(top) - 1.0f;
+    const float maxY = static_cast<float>(bottom) + 1.0f;
+    if (!clip(-dx, x0 - minX) || !clip(dx, maxX - x0) || !clip(-dy, y0 - minY) || !clip(dy, maxY - y0)) {
+        return;
+    }
+
+    const std::int64_t steps = static_cast<std::int64_t>(std::ceil(std::max(std::fabs(dx), std::fabs(dy))));
+    const float stepX = steps > 0 ? dx / static_cast<float>(steps) : 0.0f;
+    const float stepY = steps > 0 ? dy / static_cast<float>(steps) : 0.0f;
+    const std::int64_t first = std::max<std::int64_t>(static_cast<std::int64_t>(std::floor(t0 * steps)) - 1, 0);
+    const std::int64_t last = std::min<std::int64_t>(static_cast<std::int64_t>(std::ceil(t1 * steps)) + 1, steps);
+    for (std::int64_t i = first; i <= last; ++i) {
+        const float x = x0 + stepX * static_cast<float>(i);
+        const float y = y0 + stepY * static_cast<float>(i);
+        if (x >= static_cast<float>(left) && x < static_cast<float>(right) && y >= static_cast<float>(top) &&
+            y < static_cast<float>(bottom)) {
+            plot(static_cast<int>(std::floor(x)), static_cast<int>(std::floor(y)));
+        }
+    }
+}
+
+// rasterizeLine clipped to a whole width x height image
+template <typename Plot>
+void rasterizeLine(float x0, float y0, float x1, float y1, int width, int height, Plot&& plot) {
+    rasterizeLine(x0, y0, x1, y1, 0, 0, width, height, plot);
+}
+
+#endif // LINERASTERIZER_H
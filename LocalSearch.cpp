@@ -0,0 +1,42 @@
+#include "LocalSearch.h"
+
+ArrayTour::ArrayTour(const Tour& tour) : order(tour), position(tour.size()) {
+    for (std::size_t pos = 0; pos < order.size(); ++pos) {
+        position[order[pos]] = static_cast<PointId>(pos);
+    }
+}
+
+bool ArrayTour::between(std::size_t a, std::size_t b, std::size_t c) const {
+    std::size_t pa = position[a];
+    std::size_t pb = position[b];
+    std::size_t pc = position[c];
+    if (pa <= pc) {
+        return pa <= pb && pb <= pc;
+    }
+    return pb >= pa || pb <= pc;
+}
+
+void ArrayTour::reverse(std::size_t from, std::size_t to) {
+    const std::size_t n = order.size();
+    std::size_t i = position[from];
+    std::size_t j = position[to];
+    std::size_t length = (j + n - i) % n + 1;
+    if (2 * length > n) {
+        // Flip the complement instead: next(to) .. prev(from)
+        std::size_t start = j + 1 == n ? 0 : j + 1;
+        j = i == 0 ? n - 1 : i - 1;
+        i = start;
+        length = n - length;
+    }
+
+    for (std::size_t swaps = length / 2; swaps > 0; --swaps) {
+        PointId a = order[i];
+        PointId b = order[j];
+        order[i] = b;
+        position[b] = static_cast<PointId>(i);
+        order[j] = a;
+        position[a] = static_cast<PointId>(j);
+        i = i + 1 == n ? 0 : i + 1;
+        j = j == 0 ? n - 1 : j - 1;
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef LOCALSEARCH_H
+#define LOCALSEARCH_H
+
+#include "PointStore.h"
+#include "Tour.h"
+#include <cmath>
+#include <cstddef>
+#include <functional>
+#include <vector>
+
+// Outcome of a tour improvement pass.
+struct ImprovementReport {
+    double initialLength = 0.0;
+    double finalLength = 0.0;
+    double seconds = 0.0;
+    std::size_t moves = 0;
+
+    double improvement() const { return initialLength - finalLength; }
+};
+
+// Receives the tour and its length while an improvement pass is still running. The tour
+// is the pass's working copy, it is only valid during the call.
+using ImprovementCallback = std::function<void(const Tour& tour, double length)>;
+
+// Array representation of a tour for local search: order[p] is the city at position
+// p and position[c] is the position of city c, so successor, predecessor and
+// betweenness queries are O(1). Segment reversal always flips the shorter side.
+class ArrayTour {
+public:
+    explicit ArrayTour(const Tour& tour);
+
+    std::size_t size() const { return order.size(); }
+    std::size_t at(std::size_t pos) const { return order[pos]; }
+    std::size_t positionOf(std::size_t city) const { return position[city]; }
+    std::size_t next(std::size_t city) const {
+        std::size_t pos = position[city] + 1;
+        return order[pos == order.size() ? 0 : pos];
+    }
+    std::size_t prev(std::size_t city) const {
+        std::size_t pos = position[city];
+        return order[pos == 0 ? order.size() - 1 : pos - 1];
+    }
+
+    // True if b lies on the forward path from a to c, ends included
+    bool between(std::size_t a, std::size_t b, std::size_t c) const;
+
+    // Reverse the forward path from city from to city to, ends included. The cyclic
+    // tour is the same whether this or the complementary path is flipped, so the
+    // shorter of the two is reversed.
+    void reverse(std::size_t from, std::size_t to);
+
+    const std::vector<PointId>& getOrder() const { return order; }
+
+private:
+    std::vector<PointId> order;
+    std::vector<PointId> position;
+};
+
+inline double cityDistance(const PointStore& cities, std::size_t a, std::size_t b) {
+    double dx = static_cast<double>(cities.x(a)) - cities.x(b);
+    double dy = static_cast<double>(cities.y(a)) - cities.y(b);
+    return std::sqrt(dx * dx + dy * dy);
+}
+
+#endif // LOCALSEARCH_H
@@ -1,37 +1,43 @@
 #ifndef MAPMANAGER_H
 #define MAPMANAGER_H
 
+#include "PointStore.h"
 #include "Vector.h" // Include your Vector header
-#include <unordered_map>
 #include <vector>
 #include <iostream>
 
+// Points and the connections between them. Points are referred to by their dense ID,
+// so connections is a flat adjacency list indexed by ID and no coordinates are hashed.
 class MapManager {
 public:
-    // Add a point to the map
-    void addPoint(const Vector<2>& point) {
-        if (connections.find(point) == connections.end()) {
-            connections[point] = std::vector<Vector<2>>();
-        }
+    // Add a point to the map and return its ID
+    PointId addPoint(const Vector<2>& point) {
+        PointId id = static_cast<PointId>(points.add(point[0], point[1]));
+        connections.emplace_back();
+        return id;
     }
 
     // Connect two points
-    void connectPoints(const Vector<2>& point1, const Vector<2>& point2) {
+    void connectPoints(PointId point1, PointId point2) {
         connections[point1].push_back(point2);
         connections[point2].push_back(point1); // If connections are bidirectional
     }
 
+    const PointStore& getPoints() const { return points; }
+    const std::vector<PointId>& getConnections(PointId point) const { return connections[point]; }
+
     // Render the map (Pseudo-code)
     void render() const {
-        for (const auto& [point, connectedPoints] : connections) {
-            for (const auto& connectedPoint : connectedPoints) {
-                drawLine(point, connectedPoint);
+        for (std::size_t point = 0; point < connections.size(); ++point) {
+            for (PointId connectedPoint : connections[point]) {
+                drawLine(points.get(point), points.get(connectedPoint));
             }
         }
     }
 
 private:
-    std::unordered_map<Vector<2>, std::vector<Vector<2>>> connections;
+    PointStore points;
+    std::vector<std::vector<PointId>> connections;
 
     // Function to draw a line between two points (pseudo-code)
     void drawLine(const Vector<2>& start, const Vector<2>& end) const {
@@ -0,0 +1,57 @@
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::~MappedFile() {
+    close();
+}
+
+bool MappedFile::open(const char* path) {
+    close();
+
+    int descriptor = ::open(path, O_RDONLY);
+    if (descriptor < 0) {
+        std::cerr << "Failed to open " << path << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(descriptor, &info) != 0) {
+        std::cerr << "Failed to stat " << path << ": " << std::strerror(errno) << std::endl;
+        ::close(descriptor);
+        return false;
+    }
+
+    length = static_cast<std::size_t>(info.st_size);
+    if (length > 0) {
+        void* mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping == MAP_FAILED) {
+            std::cerr << "Failed to map " << path << ": " << std::strerror(errno) << std::endl;
+            ::close(descriptor);
+            length = 0;
+            return false;
+        }
+        // The file is read front to back exactly once
+        madvise(mapping, length, MADV_SEQUENTIAL);
+        bytes = static_cast<const char*>(mapping);
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    ::close(descriptor);
+    opened = true;
+    return true;
+}
+
+void MappedFile::close() {
+    if (bytes != nullptr) {
+        munmap(const_cast<char*>(bytes), length);
+    }
+    bytes = nullptr;
+    length = 0;
+    opened = false;
+}
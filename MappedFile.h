@@ -0,0 +1,33 @@
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+// Read-only memory mapping of a whole file. The pages are loaded lazily by the OS, so
+// opening is cheap and parsing streams straight from the page cache without copies.
+class MappedFile {
+public:
+    MappedFile() = default;
+    explicit MappedFile(const char* path) { open(path); }
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Returns false and reports to std::cerr if the file cannot be mapped
+    bool open(const char* path);
+    void close();
+
+    bool isOpen() const { return opened; }
+    const char* data() const { return bytes; }
+    std::size_t size() const { return length; }
+    const char* begin() const { return bytes; }
+    const char* end() const { return bytes + length; }
+
+private:
+    const char* bytes = nullptr;
+    std::size_t length = 0;
+    bool opened = false;
+};
+
+#endif // MAPPEDFILE_H
@@ -0,0 +1,35 @@
+#include "NearestNeighbour.h"
+#include "PointGrid.h"
+#include "SpaceFillingCurve.h"
+#include "Trace.h"
+
+namespace {
+
+// Steps between deadline checks, each is only a grid search
+constexpr std::size_t checkInterval = 1024;
+
+} // namespace
+
+Tour buildNearestNeighbourTour(const PointStore& cities, PointId start, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("nearestNeighbourTour");
+    Tour tour;
+    if (cities.empty()) {
+        return tour;
+    }
+    tour.reserve(cities.size());
+
+    PointGrid unvisited(cities);
+    PointId current = start < cities.size() ? start : 0;
+    unvisited.remove(current);
+    tour.push_back(current);
+    while (!unvisited.empty()) {
+        if (tour.size() % checkInterval == 0 && deadline.expired()) {
+            appendAlongCurve(cities, tour);
+            break;
+        }
+        current = static_cast<PointId>(unvisited.nearest(cities.x(current), cities.y(current)));
+        unvisited.remove(current);
+        tour.push_back(current);
+    }
+    return tour;
+}
@@ -0,0 +1,15 @@
+#ifndef NEARESTNEIGHBOUR_H
+#define NEARESTNEIGHBOUR_H
+
+#include "Deadline.h"
+#include "PointStore.h"
+#include "Tour.h"
+
+// Start at start and always move on to the closest city not visited yet. The
+// searches go through a PointGrid, so the whole walk is O(n) expected on evenly
+// spread cities and O(n^2) at worst, with O(n) memory. Tours are typically 20-25%
+// longer than optimal, most of it in the long edges back to regions passed over.
+// Once deadline expires the cities left are appended along a curve.
+Tour buildNearestNeighbourTour(const PointStore& cities, PointId start = 0, const Deadline& deadline = Deadline());
+
+#endif // NEARESTNEIGHBOUR_H
@@ -0,0 +1,175 @@
+#include "NeighbourLists.h"
+#include "KdTree.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+// Cities searched between deadline checks
+constexpr std::size_t checkInterval = 1024;
+// Candidate edges per bucket of the sort, on average, and sampled edges per splitter
+constexpr std::size_t bucketSize = 1024;
+constexpr std::size_t oversampling = 8;
+
+// Orders non-negative lengths like the lengths themselves, in steps of 1/256 of an
+// octave: the float's exponent and leading mantissa bits
+std::uint32_t lengthKey(float length) {
+    std::uint32_t bits;
+    std::memcpy(&bits, &length, sizeof(bits));
+    return bits >> 15;
+}
+
+bool shorter(const CandidateEdge& first, const CandidateEdge& second) {
+    if (first.length != second.length) {
+        return first.length < second.length;
+    }
+    return first.a != second.a ? first.a < second.a : first.b < second.b;
+}
+
+} // namespace
+
+NeighbourLists::NeighbourLists(const NeighbourLists& wider, std::size_t requested)
+    : count(wider.count), k(std::min(requested, wider.k)) {
+    neighbours.resize(count * k);
+    for (std::size_t city = 0; city < count; ++city) {
+        std::copy(wider.begin(city), wider.begin(city) + k, neighbours.begin() + city * k);
+    }
+}
+
+bool NeighbourLists::build(const PointStore& cities, std::size_t requested, const Deadline& deadline) {
+    TSM_TRACE_SCOPE("neighbourLists");
+    count = cities.size();
+    k = count > 0 ? std::min(requested, count - 1) : 0;
+    neighbours.assign(count * k, 0);
+    if (k == 0) {
+        return true;
+    }
+
+    KdTree tree(cities);
+    std::atomic<bool> expired{deadline.expired()};
+    ThreadPool::shared().parallelFor(count, 1024, [&](std::size_t first, std::size_t last) {
+        std::vector<PointId> found;
+        // In tree order: neighbouring queries walk the same paths while they are cached
+        for (std::size_t position = first; position < last; ++position) {
+            if ((position - first) % checkInterval == 0 &&
+                (expired.load(std::memory_order_relaxed) || deadline.expired())) {
+                expired.store(true, std::memory_order_relaxed);
+                return;
+            }
+            const PointId city = tree.idAt(position);
+            // Ask for one more, the city finds itself
+            tree.kNearest(cities.get(city), k + 1, found);
+            PointId* out = neighbours.data() + city * k;
+            std::size_t written = 0;
+            for (PointId candidate : found) {
+                if (candidate != city && written < k) {
+                    out[written++] = candidate;
+                }
+            }
+        }
+    });
+    if (expired) {
+        *this = NeighbourLists();
+        return false;
+    }
+    return true;
+}
+
+std::vector<CandidateEdge> sortedCandidateEdges(const PointStore& cities, const NeighbourLists& neighbours,
+                                                const Deadline& deadline) {
+    TSM_TRACE_SCOPE("candidateEdges");
+    std::vector<CandidateEdge> edges;
+    edges.reserve(neighbours.size() * neighbours.perCity());
+    float shortest = std::numeric_limits<float>::infinity();
+    float longest = 0.0f;
+    for (std::size_t city = 0; city < neighbours.size(); ++city) {
+        for (const PointId* it = neighbours.begin(city); it != neighbours.end(city); ++it) {
+            const PointId a = static_cast<PointId>(std::min<std::size_t>(city, *it));
+            const PointId b = static_cast<PointId>(std::max<std::size_t>(city, *it));
+            const float dx = cities.x(a) - cities.x(b);
+            const float dy = cities.y(a) - cities.y(b);
+            const float length = std::sqrt(dx * dx + dy * dy);
+            shortest = std::min(shortest, length);
+            longest = std::max(longest, length);
+            edges.push_back({length, a, b});
+        }
+    }
+    if (edges.empty() || deadline.expired()) {
+        return {};
+    }
+
+    // A sample sort, so the deadline can be checked between buckets: splitters drawn
+    // from evenly spaced edges cut the edges into ordered buckets of about bucketSize,
+    // which are then sorted one by one
+    std::vector<CandidateEdge> splitters;
+    const std::size_t buckets = std::max<std::size_t>(edges.size() / bucketSize, 1);
+    const std::size_t samples = (buckets - 1) * oversampling;
+    for (std::size_t i = 0; i < samples; ++i) {
+        splitters.push_back(edges[edges.size() * i / samples]);
+    }
+    std::sort(splitters.begin(), splitters.end(), shorter);
+    for (std::size_t i = 0; i + 1 < buckets; ++i) {
+        splitters[i] = splitters[i * oversampling + oversampling - 1];
+    }
+    splitters.resize(buckets - 1);
+
+    // Splitters by length key, so an edge is only compared with those sharing its key
+    std::vector<std::uint32_t> keyStarts(lengthKey(longest) - lengthKey(shortest) + 2, 0);
+    for (const CandidateEdge& splitter : splitters) {
+        ++keyStarts[lengthKey(splitter.length) - lengthKey(shortest) + 1];
+    }
+    for (std::size_t key = 1; key < keyStarts.size(); ++key) {
+        keyStarts[key] += keyStarts[key - 1];
+    }
+
+    std::vector<std::uint32_t> bucketOf(edges.size());
+    ThreadPool::shared().parallelFor(edges.size(), 1 << 14, [&](std::size_t first, std::size_t last) {
+        for (std::size_t e = first; e < last; ++e) {
+            const std::size_t key = lengthKey(edges[e].length) - lengthKey(shortest);
+            bucketOf[e] = static_cast<std::uint32_t>(std::upper_bound(splitters.begin() + keyStarts[key],
+                                                                      splitters.begin() + keyStarts[key + 1],
+                                                                      edges[e], shorter) -
+                                                     splitters.begin());
+        }
+    });
+    std::vector<std::size_t> starts(buckets + 1, 0);
+    for (std::uint32_t bucket : bucketOf) {
+        ++starts[bucket + 1];
+    }
+    for (std::size_t bucket = 0; bucket < buckets; ++bucket) {
+        starts[bucket + 1] += starts[bucket];
+    }
+    std::vector<CandidateEdge> sorted(edges.size());
+    std::vector<std::size_t> filled(starts.begin(), starts.end() - 1);
+    for (std::size_t e = 0; e < edges.size(); ++e) {
+        sorted[filled[bucketOf[e]]++] = edges[e];
+    }
+    edges = std::vector<CandidateEdge>();
+
+    std::atomic<bool> expired{false};
+    ThreadPool::shared().parallelFor(buckets, 16, [&](std::size_t first, std::size_t last) {
+        for (std::size_t bucket = first; bucket < last; ++bucket) {
+            if (expired.load(std::memory_order_relaxed) || deadline.expired()) {
+                expired.store(true, std::memory_order_relaxed);
+                return;
+            }
+            std::sort(sorted.begin() + starts[bucket], sorted.begin() + starts[bucket + 1], shorter);
+        }
+    });
+    if (expired) {
+        return {};
+    }
+    // Mutual candidates show up twice, next to each other after the sort
+    sorted.erase(std::unique(sorted.begin(), sorted.end(),
+                             [](const CandidateEdge& first, const CandidateEdge& second) {
+                                 return first.a == second.a && first.b == second.b;
+                             }),
+                 sorted.end());
+    return sorted;
+}
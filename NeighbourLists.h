@@ -0,0 +1,48 @@
+#ifndef NEIGHBOURLISTS_H
+#define NEIGHBOURLISTS_H
+
+#include "Deadline.h"
+#include "PointStore.h"
+#include <cstddef>
+#include <vector>
+
+// The k nearest other cities of every city, flat in one array and ordered by
+// increasing distance. Local search only tries moves towards these candidates.
+class NeighbourLists {
+public:
+    NeighbourLists() = default;
+    NeighbourLists(const PointStore& cities, std::size_t k) { build(cities, k); }
+    // The first k candidates of each of wider's lists, without another search
+    NeighbourLists(const NeighbourLists& wider, std::size_t k);
+
+    // O(n k log n) through a KdTree over the cities. Returns false and leaves no lists
+    // if deadline expires first.
+    bool build(const PointStore& cities, std::size_t k, const Deadline& deadline = Deadline());
+
+    std::size_t size() const { return count; }
+    // Neighbours per city. Smaller than the requested k if there are too few cities.
+    std::size_t perCity() const { return k; }
+
+    const PointId* begin(std::size_t city) const { return neighbours.data() + city * k; }
+    const PointId* end(std::size_t city) const { return neighbours.data() + (city + 1) * k; }
+
+private:
+    std::size_t count = 0;
+    std::size_t k = 0;
+    std::vector<PointId> neighbours;
+};
+
+// An undirected edge between a city and one of its candidates
+struct CandidateEdge {
+    float length;
+    PointId a;
+    PointId b;
+};
+
+// Every candidate edge once, a < b, shortest first with ties ordered by the cities.
+// O(n k log(n k)), sorted on the shared thread pool. Returns no edges if deadline
+// expires first.
+std::vector<CandidateEdge> sortedCandidateEdges(const PointStore& cities, const NeighbourLists& neighbours,
+                                                const Deadline& deadline = Deadline());
+
+#endif // NEIGHBOURLISTS_H
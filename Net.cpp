@@ -0,0 +1,72 @@
+#include "Net.h"
+#include "DistanceKernels.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <cmath>
+#include <iostream>
+
+Vector<2> calculateCenter(const PointStore& points) {
+    TSM_TRACE_SCOPE("centroid");
+    if (points.empty()) {
+        return Vector<2>{0.0f, 0.0f};
+    }
+
+    // Fixed-size ranges summed in order, so the center does not depend on the thread count
+    const DistanceKernels& kernels = getDistanceKernels();
+    const std::size_t grain = 1 << 16;
+    auto add = [](double a, double b) { return a + b; };
+    double middlePointX = ThreadPool::shared().parallelReduce(points.size(), grain, 0.0,
+        [&](std::size_t begin, std::size_t end) { return kernels.sum(points.xData() + begin, end - begin); }, add);
+    double middlePointY = ThreadPool::shared().parallelReduce(points.size(), grain, 0.0,
+        [&](std::size_t begin, std::size_t end) { return kernels.sum(points.yData() + begin, end - begin); }, add);
+
+    middlePointX /= static_cast<double>(points.size());
+    middlePointY /= static_cast<double>(points.size());
+
+    return Vector<2>{middlePointX, middlePointY};
+}
+
+void addRingPoints(PointStore& points, const Vector<2>& center, float radius, int count) {
+    if (count <= 0) {
+        return;
+    }
+
+    float angleIncrement = 2 * M_PI / count;
+    for (int i = 0; i < count; ++i) {
+        float angle = i * angleIncrement;
+        float x = center[0] + radius * std::cos(angle);
+        float y = center[1] + radius * std::sin(angle);
+        points.add(x, y);
+    }
+}
+
+PointStore createNetPoints(const Vector<2>& center, int numberOfPoints) {
+    TSM_TRACE_SCOPE("createNetPoints");
+    const int numPoints = numberOfPoints * 2;
+    const int radiusIncrement = numberOfPoints;
+
+    PointStore net;
+    if (numberOfPoints <= 0) {
+        net.add(center[0], center[1]);
+        return net;
+    }
+    net.reserve(1 + static_cast<std::size_t>(radiusIncrement) * numPoints);
+    net.add(center[0], center[1]);
+
+    float radius = 0;
+    for (int j = 0; j < radiusIncrement; ++j) {
+        radius += NET_RING_SPACING;
+        addRingPoints(net, center, radius, numPoints);
+    }
+
+    return net;
+}
+
+PointStore createNet(const PointStore& cities, int numberOfPoints) {
+    TSM_TRACE_SCOPE("createNet");
+    if (cities.empty()) {
+        std::cerr << "No points available to calculate the middle point." << std::endl;
+    }
+
+    return createNetPoints(calculateCenter(cities), numberOfPoints);
+}
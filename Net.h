@@ -0,0 +1,24 @@
+#ifndef NET_H
+#define NET_H
+
+#include "PointStore.h"
+#include "Vector.h"
+
+// Distance between two consecutive rings of the net.
+constexpr float NET_RING_SPACING = 50.0f;
+
+// Centroid of all points. Returns the origin for an empty set.
+Vector<2> calculateCenter(const PointStore& points);
+
+// Append count points evenly spaced on a circle of the given radius around center,
+// starting at angle 0 and going counter-clockwise in screen coordinates.
+void addRingPoints(PointStore& points, const Vector<2>& center, float radius, int count);
+
+// Lay out the net around center: the center itself followed by numberOfPoints rings,
+// each NET_RING_SPACING further out and holding numberOfPoints * 2 evenly spaced points.
+PointStore createNetPoints(const Vector<2>& center, int numberOfPoints);
+
+// Build the net around the centroid of the given cities.
+PointStore createNet(const PointStore& cities, int numberOfPoints);
+
+#endif // NET_H
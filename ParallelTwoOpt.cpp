@@ -0,0 +1,381 @@
+#include "ParallelTwoOpt.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+namespace {
+
+// Gains smaller than this are treated as rounding noise
+constexpr double MIN_GAIN = 1e-7;
+// Longest chain of cities an Or-opt move relocates
+constexpr std::size_t MAX_CHAIN = 3;
+// Rounds that shorten the tour by less than this fraction count as idle. Late rounds
+// mostly pass a few moves back and forth over the boundaries for next to nothing.
+constexpr double MIN_ROUND_GAIN = 1e-4;
+
+// State the segments of a round share. owner is fixed during a round, and each segment
+// only writes its own part of the tour and the entries of its own cities.
+struct Round {
+    const PointStore& cities;
+    const NeighbourLists& neighbours;
+    PointId* order;
+    std::vector<PointId>& position;
+    const std::vector<std::uint32_t>& owner;
+    std::vector<char>& queued;
+    // Cities to look at in the next round: set for all at first, then for those whose
+    // search was cut short by a segment boundary
+    std::vector<char>& retry;
+    std::chrono::steady_clock::time_point start;
+    double timeLimitSeconds;
+    const std::atomic<bool>* stop;
+    // Set by the first segment that sees the time limit or stop, the others follow
+    std::atomic<bool> expired{false};
+
+    bool checkExpired() {
+        if (expired.load(std::memory_order_relaxed)) {
+            return true;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (seconds > timeLimitSeconds || (stop != nullptr && stop->load(std::memory_order_relaxed))) {
+            expired.store(true, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
+};
+
+// Local search on the cities at tour positions [begin, end), treated as a path whose
+// first and last city stay where they are. Candidates owned by other segments are
+// skipped, so the tour outside the segment is neither read nor written.
+class SegmentSearch {
+public:
+    SegmentSearch(Round& round, std::uint32_t id, std::size_t begin, std::size_t end)
+        : round(round), id(id), begin(begin), size(end - begin), order(round.order + begin) {}
+
+    void run() {
+        queue.clear();
+        for (std::size_t i = 0; i < size; ++i) {
+            const PointId city = order[i];
+            if (round.retry[city]) {
+                round.retry[city] = 0;
+                round.queued[city] = 1;
+                queue.push_back(city);
+            }
+        }
+
+        std::size_t steps = 0;
+        while (!queue.empty()) {
+            if ((++steps & 255) == 0 && round.checkExpired()) {
+                break;
+            }
+            const PointId a = queue.front();
+            queue.pop_front();
+            round.queued[a] = 0;
+            blocked = false;
+            if (twoOptMove(a) || orOptMove(a)) {
+                ++moves;
+            } else if (blocked) {
+                round.retry[a] = 1;
+            }
+        }
+        // Cut off by the time limit, the rest would be looked at next round
+        for (PointId city : queue) {
+            round.queued[city] = 0;
+            round.retry[city] = 1;
+        }
+    }
+
+    double getGain() const { return gain; }
+    std::size_t getMoves() const { return moves; }
+
+private:
+    std::size_t local(PointId city) const { return round.position[city] - begin; }
+    bool owns(PointId city) const { return round.owner[city] == id; }
+    double distance(PointId a, PointId b) const { return cityDistance(round.cities, a, b); }
+
+    void activate(PointId city) {
+        if (!round.queued[city]) {
+            round.queued[city] = 1;
+            queue.push_back(city);
+        }
+    }
+
+    void updatePositions(std::size_t from, std::size_t to) {
+        for (std::size_t i = from; i <= to; ++i) {
+            round.position[order[i]] = static_cast<PointId>(begin + i);
+        }
+    }
+
+    // Reverse the cities at local positions from..to, ends included
+    void reverse(std::size_t from, std::size_t to) {
+        std::reverse(order + from, order + to + 1);
+        updatePositions(from, to);
+    }
+
+    // Replace edges (a, b) and (c, d) with (a, c) and (b, d), where b and d are the
+    // successors of a and c, or both their predecessors
+    bool twoOptMove(PointId a) {
+        const std::size_t i = local(a);
+        for (int direction = 0; direction < 2; ++direction) {
+            const bool forward = direction == 0;
+            if (forward ? i + 1 >= size : i == 0) {
+                blocked = true;
+                continue;
+            }
+            const PointId b = order[forward ? i + 1 : i - 1];
+            const double ab = distance(a, b);
+
+            for (const PointId* it = round.neighbours.begin(a); it != round.neighbours.end(a); ++it) {
+                const PointId c = *it;
+                const double ac = distance(a, c);
+                // Candidates are sorted, so no later one can shorten the path either
+                if (ac >= ab) {
+                    break;
+                }
+                if (!owns(c)) {
+                    blocked = true;
+                    continue;
+                }
+                const std::size_t j = local(c);
+                if (forward ? j + 1 >= size : j == 0) {
+                    blocked = true;
+                    continue;
+                }
+                const PointId d = order[forward ? j + 1 : j - 1];
+                if (c == b || d == a) {
+                    continue;
+                }
+
+                const double moveGain = ab + distance(c, d) - ac - distance(b, d);
+                if (moveGain > MIN_GAIN) {
+                    if (forward) {
+                        reverse(std::min(i, j) + 1, std::max(i, j));
+                    } else {
+                        reverse(std::min(i, j), std::max(i, j) - 1);
+                    }
+                    gain += moveGain;
+                    activate(a);
+                    activate(b);
+                    activate(c);
+                    activate(d);
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Move a chain of up to MAX_CHAIN cities that starts or ends at a elsewhere
+    bool orOptMove(PointId a) {
+        const std::size_t i = local(a);
+        for (std::size_t length = 1; length <= MAX_CHAIN; ++length) {
+            for (int side = 0; side < (length == 1 ? 1 : 2); ++side) {
+                if (side == 1 && i < length - 1) {
+                    continue;
+                }
+                const std::size_t first = side == 0 ? i : i - (length - 1);
+                const std::size_t last = first + length - 1;
+                // The chain needs a city on either side, the segment's ends stay put
+                if (first == 0 || last + 1 >= size) {
+                    blocked = true;
+                    continue;
+                }
+                if (moveChain(first, last)) {
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    // Try to reinsert the chain at local positions first..last next to one of the
+    // candidates of its end cities, in whichever direction fits
+    bool moveChain(std::size_t first, std::size_t last) {
+        const PointId p = order[first - 1];
+        const PointId s1 = order[first];
+        const PointId s2 = order[last];
+        const PointId n = order[last + 1];
+        const double removed = distance(p, s1) + distance(s2, n) - distance(p, n);
+        if (removed <= MIN_GAIN) {
+            return false;
+        }
+
+        for (int endIndex = 0; endIndex < (s1 == s2 ? 1 : 2); ++endIndex) {
+            const PointId end = endIndex == 0 ? s1 : s2;
+            const PointId other = endIndex == 0 ? s2 : s1;
+            for (const PointId* it = round.neighbours.begin(end); it != round.neighbours.end(end); ++it) {
+                const PointId c = *it;
+                const double ec = distance(end, c);
+                // The new edge to c alone costs as much as the removal saves
+                if (ec >= removed) {
+                    break;
+                }
+                if (!owns(c)) {
+                    blocked = true;
+                    continue;
+                }
+                const std::size_t j = local(c);
+                if (j >= first && j <= last) {
+                    continue;
+                }
+
+                // Insert into the edge (x, y) on either side of c
+                for (int edge = 0; edge < 2; ++edge) {
+                    if (edge == 1 && j == 0) {
+                        blocked = true;
+                        continue;
+                    }
+                    const std::size_t k = edge == 0 ? j : j - 1;
+                    if (k + 1 >= size) {
+                        blocked = true;
+                        continue;
+                    }
+                    if (k + 1 >= first && k <= last) {
+                        continue;
+                    }
+                    const PointId x = order[k];
+                    const PointId y = order[k + 1];
+                    // end sits next to c, the chain is reversed if that puts s2 first
+                    const double added = c == x ? ec + distance(other, y) - distance(x, y)
+                                                : distance(x, other) + ec - distance(x, y);
+                    const bool reversed = (c == x) == (end == s2);
+                    const double moveGain = removed - added;
+                    if (moveGain > MIN_GAIN) {
+                        insertChain(first, last, k, reversed);
+                        gain += moveGain;
+                        activate(p);
+                        activate(n);
+                        activate(s1);
+                        activate(s2);
+                        activate(x);
+                        activate(y);
+                        return true;
+                    }
+                }
+            }
+        }
+        return false;
+    }
+
+    // Move the chain at first..last between local positions k and k + 1
+    void insertChain(std::size_t first, std::size_t last, std::size_t k, bool reversed) {
+        const std::size_t length = last - first + 1;
+        std::size_t chain;
+        if (k > last) {
+            std::rotate(order + first, order + last + 1, order + k + 1);
+            chain = k + 1 - length;
+            updatePositions(first, k);
+        } else {
+            std::rotate(order + k + 1, order + first, order + last + 1);
+            chain = k + 1;
+            updatePositions(k + 1, last);
+        }
+        if (reversed) {
+            reverse(chain, chain + length - 1);
+        }
+    }
+
+    Round& round;
+    const std::uint32_t id;
+    const std::size_t begin;
+    const std::size_t size;
+    PointId* order;
+    std::deque<PointId> queue;
+    // Whether a move of the city being looked at was ruled out by the segment's bounds
+    bool blocked = false;
+    double gain = 0.0;
+    std::size_t moves = 0;
+};
+
+} // namespace
+
+ImprovementReport improveParallelTwoOpt(const PointStore& cities, Tour& tour, const ParallelTwoOptOptions& options) {
+    NeighbourLists neighbours(cities, options.neighbours);
+    return improveParallelTwoOpt(cities, tour, neighbours, options);
+}
+
+ImprovementReport improveParallelTwoOpt(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                        const ParallelTwoOptOptions& options) {
+    TSM_TRACE_SCOPE("parallelTwoOpt");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ImprovementReport report;
+    report.initialLength = tourLength(cities, tour);
+    report.finalLength = report.initialLength;
+    const std::size_t n = tour.size();
+    if (n < 8) {
+        return report;
+    }
+
+    std::size_t segmentSize = options.segmentSize;
+    if (segmentSize == 0) {
+        segmentSize = static_cast<std::size_t>(16.0 * std::sqrt(static_cast<double>(n)));
+    }
+    segmentSize = std::max<std::size_t>(segmentSize, 8);
+    const std::size_t segments = std::max<std::size_t>(n / segmentSize, 1);
+    const PointId firstCity = tour.front();
+    std::vector<PointId> position(n);
+    std::vector<std::uint32_t> owner(n);
+    std::vector<char> queued(n, 0);
+    std::vector<char> retry(n, 1);
+    std::vector<double> gains(segments);
+    std::vector<std::size_t> moves(segments);
+    Round round{cities, neighbours, tour.data(), position, owner, queued, retry, start, options.timeLimitSeconds,
+                options.stop};
+
+    ThreadPool& pool = ThreadPool::shared();
+    double length = report.initialLength;
+    double lastProgress = 0.0;
+    int idleRounds = 0;
+    for (int index = 0; index < options.maxRounds && idleRounds < 2; ++index) {
+        if (index > 0) {
+            // Shift the boundaries by half a segment, the cycle itself stays the same
+            std::rotate(tour.begin(), tour.begin() + (segmentSize / 2) % n, tour.end());
+        }
+        pool.forEachChunk(n, segments, [&](std::size_t segment, std::size_t begin, std::size_t end) {
+            for (std::size_t i = begin; i < end; ++i) {
+                position[tour[i]] = static_cast<PointId>(i);
+                owner[tour[i]] = static_cast<std::uint32_t>(segment);
+            }
+        });
+        pool.forEachChunk(n, segments, [&](std::size_t segment, std::size_t begin, std::size_t end) {
+            SegmentSearch search(round, static_cast<std::uint32_t>(segment), begin, end);
+            search.run();
+            gains[segment] = search.getGain();
+            moves[segment] = search.getMoves();
+        });
+
+        // Summed in segment order, like the rest independent of the thread count
+        double roundGain = 0.0;
+        std::size_t roundMoves = 0;
+        for (std::size_t segment = 0; segment < segments; ++segment) {
+            roundGain += gains[segment];
+            roundMoves += moves[segment];
+        }
+        idleRounds = roundGain < MIN_ROUND_GAIN * length ? idleRounds + 1 : 0;
+        length -= roundGain;
+        report.moves += roundMoves;
+        if (round.expired.load(std::memory_order_relaxed)) {
+            break;
+        }
+        const double seconds = elapsed();
+        if (options.progress && roundMoves > 0 && seconds - lastProgress >= options.progressSeconds) {
+            lastProgress = seconds;
+            options.progress(tour, length);
+        }
+    }
+
+    // Start at the same city as before
+    std::rotate(tour.begin(), std::find(tour.begin(), tour.end(), firstCity), tour.end());
+    report.finalLength = tourLength(cities, tour);
+    report.seconds = elapsed();
+    return report;
+}
@@ -0,0 +1,45 @@
+#ifndef PARALLELTWOOPT_H
+#define PARALLELTWOOPT_H
+
+#include "LocalSearch.h"
+#include "NeighbourLists.h"
+#include "PointStore.h"
+#include "Tour.h"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+struct ParallelTwoOptOptions {
+    // Candidate neighbours per city
+    std::size_t neighbours = 8;
+    // Cities per segment, 0 uses 16 sqrt(n). Moves stay inside a segment, and the
+    // segment has to span several rows of a tour that sweeps the plane for most of the
+    // useful moves to fit: much smaller segments stall, much larger ones make every
+    // reversal slower and leave fewer segments to spread over the threads.
+    std::size_t segmentSize = 0;
+    // Rounds stop earlier once two in a row, one per boundary offset, found next to nothing
+    int maxRounds = 100;
+    double timeLimitSeconds = std::numeric_limits<double>::infinity();
+    // Checked along with the time limit, the search stops early once it is set
+    const std::atomic<bool>* stop = nullptr;
+    // Called with the improved tour at most every progressSeconds, between rounds
+    ImprovementCallback progress;
+    double progressSeconds = 0.05;
+};
+
+// 2-opt and Or-opt (moving chains of up to 3 cities, reversed or not) on the shared
+// thread pool. Each round cuts the tour into segments of consecutive cities, which a
+// reasonable tour keeps spatially compact, and improves all of them concurrently as
+// paths whose end cities stay in place, so the segments never interfere. The next
+// round shifts the boundaries by half a segment to reach the moves they cut off.
+// Only improving moves are made, so the tour never gets longer. The segments depend
+// only on the tour and segmentSize, so unless the time limit or stop cuts a run short
+// the result is the same for any thread count.
+ImprovementReport improveParallelTwoOpt(const PointStore& cities, Tour& tour,
+                                        const ParallelTwoOptOptions& options = ParallelTwoOptOptions());
+
+// Same, reusing candidate lists that were already built over cities.
+ImprovementReport improveParallelTwoOpt(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                        const ParallelTwoOptOptions& options = ParallelTwoOptOptions());
+
+#endif // PARALLELTWOOPT_H
@@ -0,0 +1,160 @@
+#include "PointGrid.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+namespace {
+
+// Cities per cell right after a build
+constexpr float citiesPerCell = 2.0f;
+
+} // namespace
+
+PointGrid::PointGrid(const PointStore& cities) : cities(&cities), slots(cities.size(), NONE) {
+    std::vector<PointId> members(cities.size());
+    std::iota(members.begin(), members.end(), PointId{0});
+    build(std::move(members));
+}
+
+PointGrid::PointGrid(const PointStore& cities, const std::vector<PointId>& members)
+    : cities(&cities), slots(cities.size(), NONE) {
+    build(members);
+}
+
+void PointGrid::build(std::vector<PointId> members) {
+    remaining = members.size();
+    builtWith = members.size();
+    if (members.empty()) {
+        items.clear();
+        cellStarts.assign(2, 0);
+        cellCounts.assign(1, 0);
+        columns = 1;
+        rows = 1;
+        return;
+    }
+
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+    minX = std::numeric_limits<float>::max();
+    minY = std::numeric_limits<float>::max();
+    for (PointId city : members) {
+        minX = std::min(minX, cities->x(city));
+        minY = std::min(minY, cities->y(city));
+        maxX = std::max(maxX, cities->x(city));
+        maxY = std::max(maxY, cities->y(city));
+    }
+    // Square cells, about citiesPerCell cities each on evenly spread cities. Degenerate
+    // extents still get a positive cell size so every city maps to a cell.
+    const float width = std::max(maxX - minX, 0.0f);
+    const float height = std::max(maxY - minY, 0.0f);
+    const float cells = std::max(1.0f, static_cast<float>(members.size()) / citiesPerCell);
+    const float area = std::max(width * height, std::max(width, height) * std::max(width, height) / cells);
+    cellSize = std::sqrt(area / cells);
+    if (!(cellSize > 0.0f)) {
+        cellSize = 1.0f;
+    }
+    columns = static_cast<long>(width / cellSize) + 1;
+    rows = static_cast<long>(height / cellSize) + 1;
+
+    // Counting sort of the cities by cell
+    cellStarts.assign(static_cast<std::size_t>(columns * rows) + 1, 0);
+    for (PointId city : members) {
+        ++cellStarts[cellOf(cities->x(city), cities->y(city)) + 1];
+    }
+    std::partial_sum(cellStarts.begin(), cellStarts.end(), cellStarts.begin());
+    cellCounts.assign(cellStarts.size() - 1, 0);
+    items.resize(members.size());
+    for (PointId city : members) {
+        const std::size_t cell = cellOf(cities->x(city), cities->y(city));
+        const std::uint32_t slot = cellStarts[cell] + cellCounts[cell]++;
+        items[slot] = city;
+        slots[city] = slot;
+    }
+}
+
+std::size_t PointGrid::cellOf(float x, float y) const {
+    const long column = std::clamp(static_cast<long>((x - minX) / cellSize), 0L, columns - 1);
+    const long row = std::clamp(static_cast<long>((y - minY) / cellSize), 0L, rows - 1);
+    return cellAt(column, row);
+}
+
+void PointGrid::remove(PointId city) {
+    const std::size_t cell = cellOf(cities->x(city), cities->y(city));
+    const std::uint32_t slot = slots[city];
+    const std::uint32_t last = cellStarts[cell] + --cellCounts[cell];
+    items[slot] = items[last];
+    slots[items[slot]] = slot;
+    items[last] = city;
+    slots[city] = NONE;
+    --remaining;
+
+    if (remaining > 0 && remaining * 4 < builtWith) {
+        std::vector<PointId> members;
+        members.reserve(remaining);
+        for (std::size_t c = 0; c < cellCounts.size(); ++c) {
+            members.insert(members.end(), items.begin() + cellStarts[c], items.begin() + cellStarts[c] + cellCounts[c]);
+        }
+        build(std::move(members));
+    }
+}
+
+std::size_t PointGrid::nearest(float x, float y) const {
+    std::size_t best = cities->size();
+    if (remaining == 0) {
+        return best;
+    }
+    float bestDistance = std::numeric_limits<float>::max();
+    auto scan = [&](long column, long row) {
+        const std::size_t cell = cellAt(column, row);
+        const std::uint32_t begin = cellStarts[cell];
+        const std::uint32_t end = begin + cellCounts[cell];
+        for (std::uint32_t slot = begin; slot < end; ++slot) {
+            const PointId city = items[slot];
+            const float dx = cities->x(city) - x;
+            const float dy = cities->y(city) - y;
+            const float distance = dx * dx + dy * dy;
+            if (distance < bestDistance || (distance == bestDistance && city < best)) {
+                bestDistance = distance;
+                best = city;
+            }
+        }
+    };
+
+    // Rings of cells around the query's cell, clamped into the grid. Every city in
+    // ring r is at least (r - 1) cells away, even for queries outside the grid.
+    const long column = std::clamp(static_cast<long>((x - minX) / cellSize), 0L, columns - 1);
+    const long row = std::clamp(static_cast<long>((y - minY) / cellSize), 0L, rows - 1);
+    const long maxRing = std::max({column, columns - 1 - column, row, rows - 1 - row});
+    for (long ring = 0; ring <= maxRing; ++ring) {
+        if (best != cities->size()) {
+            const float gap = static_cast<float>(ring - 1) * cellSize;
+            if (ring > 0 && gap * gap > bestDistance) {
+                break;
+            }
+        }
+        const long left = std::max(column - ring, 0L);
+        const long right = std::min(column + ring, columns - 1);
+        const long bottom = std::max(row - ring, 0L);
+        const long top = std::min(row + ring, rows - 1);
+        // Rows at the ring's top and bottom edge, then the columns between them
+        for (long r : {row - ring, row + ring}) {
+            if (r >= 0 && r < rows) {
+                for (long c = left; c <= right; ++c) {
+                    scan(c, r);
+                }
+            }
+            if (ring == 0) {
+                break;
+            }
+        }
+        for (long c : {column - ring, column + ring}) {
+            if (ring > 0 && c >= 0 && c < columns) {
+                for (long r = std::max(bottom, row - ring + 1); r <= std::min(top, row + ring - 1); ++r) {
+                    scan(c, r);
+                }
+            }
+        }
+    }
+    return best;
+}
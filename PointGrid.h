@@ -0,0 +1,59 @@
+#ifndef POINTGRID_H
+#define POINTGRID_H
+
+#include "PointStore.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid over some of the cities from which cities can be removed, for
+// constructions that keep asking for the closest city still left. Cells hold about
+// two cities each. Once removals leave a quarter of the cities the grid was built
+// with, it is rebuilt over the rest with proportionally fewer cells, which keeps the
+// searches local until the very end: nearest() is O(1) expected on evenly spread
+// cities, and the rebuilds add O(n) over all removals.
+class PointGrid {
+public:
+    // Over all cities
+    explicit PointGrid(const PointStore& cities);
+    // Over the listed cities only. cities must outlive the grid.
+    PointGrid(const PointStore& cities, const std::vector<PointId>& members);
+
+    // Cities left
+    std::size_t size() const { return remaining; }
+    bool empty() const { return remaining == 0; }
+    bool contains(PointId city) const { return slots[city] != NONE; }
+
+    // Take a city out. It must still be contained.
+    void remove(PointId city);
+
+    // Closest city left to (x, y), ties going to the lowest ID, or cities.size() if
+    // the grid is empty.
+    std::size_t nearest(float x, float y) const;
+
+private:
+    static constexpr std::uint32_t NONE = ~std::uint32_t{0};
+
+    // Redistribute the cities left over a grid sized for them
+    void build(std::vector<PointId> members);
+    std::size_t cellOf(float x, float y) const;
+    std::size_t cellAt(long column, long row) const { return static_cast<std::size_t>(row * columns + column); }
+
+    const PointStore* cities;
+    float minX = 0.0f;
+    float minY = 0.0f;
+    float cellSize = 1.0f;
+    long columns = 1;
+    long rows = 1;
+    // Cities grouped by cell. The first cellCounts[c] from cellStarts[c] are still
+    // contained, removed ones are swapped behind them.
+    std::vector<PointId> items;
+    std::vector<std::uint32_t> cellStarts;
+    std::vector<std::uint32_t> cellCounts;
+    // Position of every contained city in items, NONE for the others
+    std::vector<std::uint32_t> slots;
+    std::size_t remaining = 0;
+    std::size_t builtWith = 0;
+};
+
+#endif // POINTGRID_H
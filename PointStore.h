@@ -0,0 +1,71 @@
+#ifndef POINTSTORE_H
+#define POINTSTORE_H
+
+#include "Vector.h"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Dense point ID: an index into the flat arrays of a PointStore. Solver structures
+// refer to points by ID and look their coordinates up, never the other way round.
+using PointId = std::uint32_t;
+
+// Contiguous structure-of-arrays point storage. Coordinates live in separate x and y
+// arrays so sweeps over all points touch only the data they need. Each point also
+// carries an integer ID, which defaults to its position in the store.
+class PointStore {
+public:
+    PointStore() = default;
+
+    explicit PointStore(const std::vector<Vector<2>>& points) {
+        reserve(points.size());
+        for (const Vector<2>& point : points) {
+            add(point[0], point[1]);
+        }
+    }
+
+    void reserve(std::size_t count) {
+        xs.reserve(count);
+        ys.reserve(count);
+        ids.reserve(count);
+    }
+
+    void clear() {
+        xs.clear();
+        ys.clear();
+        ids.clear();
+    }
+
+    // Append a point and return its position in the store
+    std::size_t add(float x, float y) {
+        return add(x, y, static_cast<PointId>(xs.size()));
+    }
+
+    std::size_t add(float x, float y, PointId id) {
+        xs.push_back(x);
+        ys.push_back(y);
+        ids.push_back(id);
+        return xs.size() - 1;
+    }
+
+    std::size_t size() const { return xs.size(); }
+    bool empty() const { return xs.empty(); }
+
+    float x(std::size_t index) const { return xs[index]; }
+    float y(std::size_t index) const { return ys[index]; }
+    PointId id(std::size_t index) const { return ids[index]; }
+    Vector<2> get(std::size_t index) const { return Vector<2>{xs[index], ys[index]}; }
+
+    const float* xData() const { return xs.data(); }
+    const float* yData() const { return ys.data(); }
+    const PointId* idData() const { return ids.data(); }
+    float* xData() { return xs.data(); }
+    float* yData() { return ys.data(); }
+
+private:
+    std::vector<float> xs;
+    std::vector<float> ys;
+    std::vector<PointId> ids;
+};
+
+#endif // POINTSTORE_H
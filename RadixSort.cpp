@@ -0,0 +1,75 @@
+#include "RadixSort.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <array>
+
+namespace {
+
+constexpr unsigned digitBits = 8;
+constexpr std::size_t digitCount = std::size_t{1} << digitBits;
+// Below this a chunk's counting and scatter cost less than handing it to another thread
+constexpr std::size_t minChunk = 1 << 16;
+
+using Histogram = std::array<std::size_t, digitCount>;
+
+} // namespace
+
+void radixSort(std::vector<std::uint64_t>& values, unsigned lowBit, unsigned highBit) {
+    TSM_TRACE_SCOPE("radixSort");
+    const std::size_t count = values.size();
+    if (count < 2 || lowBit >= highBit) {
+        return;
+    }
+
+    ThreadPool& pool = ThreadPool::shared();
+    const std::size_t chunks = std::max<std::size_t>(1, std::min<std::size_t>(pool.size(), count / minChunk));
+    std::vector<Histogram> histograms(chunks);
+    std::vector<std::uint64_t> buffer(count);
+    std::uint64_t* source = values.data();
+    std::uint64_t* target = buffer.data();
+
+    for (unsigned shift = lowBit; shift < highBit; shift += digitBits) {
+        // The last pass may have fewer bits left than a full digit
+        const std::uint64_t mask = (std::uint64_t{1} << std::min(digitBits, highBit - shift)) - 1;
+
+        pool.forEachChunk(count, chunks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            Histogram& histogram = histograms[chunk];
+            histogram.fill(0);
+            for (std::size_t i = begin; i < end; ++i) {
+                ++histogram[(source[i] >> shift) & mask];
+            }
+        });
+
+        // Exclusive prefix sum, digit-major so every chunk's values of a digit land
+        // after the previous chunks' ones and the pass stays stable
+        std::size_t offset = 0;
+        bool uniform = false;
+        for (std::size_t digit = 0; digit < digitCount; ++digit) {
+            std::size_t total = 0;
+            for (Histogram& histogram : histograms) {
+                std::size_t digitValues = histogram[digit];
+                histogram[digit] = offset + total;
+                total += digitValues;
+            }
+            uniform = uniform || total == count;
+            offset += total;
+        }
+        if (uniform) {
+            continue;
+        }
+
+        pool.forEachChunk(count, chunks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+            Histogram& next = histograms[chunk];
+            for (std::size_t i = begin; i < end; ++i) {
+                std::uint64_t value = source[i];
+                target[next[(value >> shift) & mask]++] = value;
+            }
+        });
+        std::swap(source, target);
+    }
+
+    if (source != values.data()) {
+        values.swap(buffer);
+    }
+}
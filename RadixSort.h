@@ -0,0 +1,16 @@
+#ifndef RADIXSORT_H
+#define RADIXSORT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Stable LSD radix sort of values by their bits [lowBit, highBit), 8 bits per pass,
+// on the shared thread pool. Each pass counts digits per chunk in parallel, turns the
+// counts into per-chunk offsets and scatters the chunks in parallel, so the result is
+// the same for any thread count. Passes whose digit is equal for every value are
+// skipped. Bits outside the range only ride along, which lets callers pack a payload
+// such as a point ID into the low bits below a sort key.
+void radixSort(std::vector<std::uint64_t>& values, unsigned lowBit = 0, unsigned highBit = 64);
+
+#endif // RADIXSORT_H
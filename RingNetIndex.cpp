@@ -0,0 +1,119 @@
+#include "RingNetIndex.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+bool detectRingNet(const PointStore& net, RingNetGeometry& geometry) {
+    // createNetPoints(center, n) yields 1 + n rings * 2n sectors points
+    if (net.size() < 3) {
+        return false;
+    }
+    const int ringCount = static_cast<int>(std::lround(std::sqrt((net.size() - 1) / 2.0)));
+    const int sectorCount = ringCount * 2;
+    if (ringCount <= 0 || 1 + static_cast<std::size_t>(ringCount) * sectorCount != net.size()) {
+        return false;
+    }
+
+    const Vector<2> center = net.get(0);
+    const float ringSpacing = net.x(1) - center[0];
+    if (!(ringSpacing > 0.0f)) {
+        return false;
+    }
+
+    // Every point has to sit where createNetPoints would have put it
+    const float angleIncrement = 2 * M_PI / sectorCount;
+    const float tolerance = 1e-3f * ringSpacing * ringCount;
+    std::size_t index = 1;
+    for (int j = 1; j <= ringCount; ++j) {
+        float radius = j * ringSpacing;
+        for (int i = 0; i < sectorCount; ++i, ++index) {
+            float angle = i * angleIncrement;
+            float dx = net.x(index) - (center[0] + radius * std::cos(angle));
+            float dy = net.y(index) - (center[1] + radius * std::sin(angle));
+            if (std::fabs(dx) > tolerance || std::fabs(dy) > tolerance) {
+                return false;
+            }
+        }
+    }
+
+    geometry.center = center;
+    geometry.ringSpacing = ringSpacing;
+    geometry.ringCount = ringCount;
+    geometry.sectorCount = sectorCount;
+    return true;
+}
+
+void RingNetIndex::build(const PointStore& net) {
+    TSM_TRACE_SCOPE("buildNetIndex");
+    points = net;
+    geometry = RingNetGeometry();
+    ringNet = detectRingNet(net, geometry);
+    if (ringNet) {
+        fallback = KdTree();
+    } else {
+        fallback.build(net);
+    }
+}
+
+std::size_t RingNetIndex::nearest(const Vector<2>& query) const {
+    return ringNet ? nearestOnRings(query[0], query[1]) : fallback.nearest(query);
+}
+
+std::size_t RingNetIndex::nearestOnRings(float qx, float qy) const {
+    const int sectorCount = geometry.sectorCount;
+    const int ringCount = geometry.ringCount;
+    const float angleIncrement = 2 * M_PI / sectorCount;
+
+    float dx = qx - geometry.center[0];
+    float dy = qy - geometry.center[1];
+    float radius = std::sqrt(dx * dx + dy * dy);
+    float angle = std::atan2(dy, dx);
+    if (angle < 0) {
+        angle += 2 * M_PI;
+    }
+
+    // All rings share the same angles, so the closest sector is the closest in angle,
+    // and the closest ring is the one nearest to the query projected onto that ray
+    int sector = static_cast<int>(std::lround(angle / angleIncrement)) % sectorCount;
+    float projected = radius * std::cos(angle - sector * angleIncrement);
+    int ring = static_cast<int>(std::lround(projected / geometry.ringSpacing));
+    ring = std::clamp(ring, 0, ringCount);
+
+    // Confirm against the stored coordinates of the neighbouring cells
+    std::size_t best = 0;
+    float bestDistance = std::numeric_limits<float>::max();
+    for (int j = std::max(ring - 1, 0); j <= std::min(ring + 1, ringCount); ++j) {
+        for (int offset = -1; offset <= 1; ++offset) {
+            int i = (sector + offset + sectorCount) % sectorCount;
+            std::size_t index = j == 0 ? 0 : 1 + static_cast<std::size_t>(j - 1) * sectorCount + i;
+            float px = points.x(index) - qx;
+            float py = points.y(index) - qy;
+            float distance = px * px + py * py;
+            if (distance < bestDistance) {
+                bestDistance = distance;
+                best = index;
+            }
+            if (j == 0) {
+                break; // The center has no sectors
+            }
+        }
+    }
+    return best;
+}
+
+std::vector<PointId> RingNetIndex::nearestAll(const PointStore& queries) const {
+    TSM_TRACE_SCOPE("projection");
+    if (!ringNet) {
+        return fallback.nearestAll(queries);
+    }
+
+    std::vector<PointId> result(queries.size());
+    ThreadPool::shared().parallelFor(queries.size(), 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            result[i] = static_cast<PointId>(nearestOnRings(queries.x(i), queries.y(i)));
+        }
+    });
+    return result;
+}
@@ -0,0 +1,51 @@
+#ifndef RINGNETINDEX_H
+#define RINGNETINDEX_H
+
+#include "KdTree.h"
+#include "PointStore.h"
+#include "Vector.h"
+#include <cstddef>
+#include <vector>
+
+// Geometry of a net laid out by createNetPoints: the center at index 0, followed by
+// ringCount rings of sectorCount points each, ring j at radius j * ringSpacing.
+struct RingNetGeometry {
+    Vector<2> center;
+    float ringSpacing = 0.0f;
+    int ringCount = 0;
+    int sectorCount = 0;
+};
+
+// Returns true and fills geometry if net has exactly the layout createNetPoints produces.
+bool detectRingNet(const PointStore& net, RingNetGeometry& geometry);
+
+// Nearest net point lookup. For ring nets the answer is computed from the query's
+// polar coordinates by checking the 3x3 ring/sector cells around the analytic
+// solution, so every query is O(1). Any other net falls back to a KdTree.
+class RingNetIndex {
+public:
+    RingNetIndex() = default;
+    explicit RingNetIndex(const PointStore& net) { build(net); }
+
+    void build(const PointStore& net);
+
+    bool isRingNet() const { return ringNet; }
+    const RingNetGeometry& getGeometry() const { return geometry; }
+    std::size_t size() const { return points.size(); }
+
+    // Index of the net point closest to query, or size() if the net is empty.
+    std::size_t nearest(const Vector<2>& query) const;
+
+    // nearest() for every query, result[i] belongs to queries[i].
+    std::vector<PointId> nearestAll(const PointStore& queries) const;
+
+private:
+    std::size_t nearestOnRings(float qx, float qy) const;
+
+    bool ringNet = false;
+    RingNetGeometry geometry;
+    PointStore points;
+    KdTree fallback;
+};
+
+#endif // RINGNETINDEX_H
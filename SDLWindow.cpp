@@ -1,12 +1,67 @@
 #include "SDLWindow.h"
+#include "Instance.h"
+#include "Net.h"
+#include "Trace.h"
+#include "Tsplib.h"
+#include <algorithm>
 #include <iostream>
+#include <cstdio>
 #include <cstdlib>
 #include <ctime>
-#include <algorithm>
-#include <cmath>
+#include <utility>
+
+namespace {
+
+// Longest the event loop sleeps without an event. Waking up costs nothing when
+// nothing is dirty, it only bounds how stale a missed redraw can get.
+const int EVENT_WAIT_MS = 500;
+
+// Most cities the O(n^2) constructions are offered for when cycling through the modes,
+// a few seconds each
+const std::size_t MAX_QUADRATIC_CITIES = 20000;
+
+// After counting an intermediate tour into the density map, the next one waits this many
+// times as long as the count took, so large instances keep most frames for drawing
+const int DENSITY_TOUR_BACKOFF = 4;
+
+// One size x size square per point, its top left corner offset up and left from the point
+void appendRects(const PointStore& points, int size, int offset, std::vector<SDL_Rect>& rects) {
+    rects.reserve(rects.size() + points.size());
+    for (std::size_t i = 0; i < points.size(); ++i) {
+        rects.push_back({ static_cast<int>(points.x(i)) - offset, static_cast<int>(points.y(i)) - offset,
+                          size, size });
+    }
+}
+
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+// Two triangles per rect with the colour in the vertices, so all layers share one draw call
+void appendQuads(const std::vector<SDL_Rect>& rects, SDL_Color color, std::vector<SDL_Vertex>& vertices,
+                 std::vector<int>& indices) {
+    vertices.reserve(vertices.size() + rects.size() * 4);
+    indices.reserve(indices.size() + rects.size() * 6);
+    for (const SDL_Rect& rect : rects) {
+        const int first = static_cast<int>(vertices.size());
+        const float left = static_cast<float>(rect.x);
+        const float top = static_cast<float>(rect.y);
+        const float right = static_cast<float>(rect.x + rect.w);
+        const float bottom = static_cast<float>(rect.y + rect.h);
+        vertices.push_back({ { left, top }, color, { 0.0f, 0.0f } });
+        vertices.push_back({ { right, top }, color, { 0.0f, 0.0f } });
+        vertices.push_back({ { left, bottom }, color, { 0.0f, 0.0f } });
+        vertices.push_back({ { right, bottom }, color, { 0.0f, 0.0f } });
+        const int corners[6] = { 0, 1, 2, 2, 1, 3 };
+        for (int corner : corners) {
+            indices.push_back(first + corner);
+        }
+    }
+}
+#endif
+
+} // namespace
 
 SDLWindow::SDLWindow(const char* title, double width, double height)
-    : window(nullptr), quit(false), renderer(nullptr), SCREEN_WIDTH(width), SCREEN_HEIGHT(height) {
+    : window(nullptr), quit(false), renderer(nullptr), SCREEN_WIDTH(width), SCREEN_HEIGHT(height),
+      solver([this] { requestRedraw(); }) {
 
     if (SDL_Init(SDL_INIT_VIDEO) < 0) {
         std::cerr << "Failed to initialize SDL: " << SDL_GetError() << std::endl;
@@ -35,40 +90,98 @@ SDLWindow::SDLWindow(const char* title, double width, double height)
         exit(-1);
     }
 
-    srand(static_cast<unsigned>(time(0)));
+    windowTitle = title;
+    seed = static_cast<unsigned>(time(0));
+    redrawEvent = SDL_RegisterEvents(1);
 }
 
 SDLWindow::~SDLWindow() {
+    // Nothing may post events once SDL is gone
+    solver.stop();
+    destroyLayers();
     SDL_DestroyRenderer(renderer);
     SDL_DestroyWindow(window);
     SDL_Quit();
 }
 
+bool SDLWindow::loadInstance(const char* path) {
+    TsplibInstance instance;
+    if (!loadTsplib(path, instance)) {
+        return false;
+    }
+    cities = std::move(instance.cities);
+    fitToArea(cities, SCREEN_WIDTH, SCREEN_HEIGHT);
+    cityLayer.dirty = true;
+    densityDirty = true;
+    tourStale = true;
+    pointsChanged = true;
+    return true;
+}
+
 void SDLWindow::start() {
-    createPoints();
+    TSM_TRACE_SCOPE("start");
+    if (cities.empty()) {
+        createPoints();
+    }
     createNet();
     while (!quit) {
-        handleEvents();
+        if (tourStale) {
+            submitSolve();
+        }
+
+        // Block until there is input instead of polling, then drain the queue. A frame
+        // that is already due, such as a deferred density recount, only takes the
+        // queued input; the vsynced present paces those frames.
+        SDL_Event event;
+        const bool received =
+            needsRedraw ? SDL_PollEvent(&event) != 0 : SDL_WaitEventTimeout(&event, EVENT_WAIT_MS) != 0;
+        if (received) {
+            handleEvent(event);
+            while (SDL_PollEvent(&event) != 0) {
+                handleEvent(event);
+            }
+        }
+        if (quit || !needsRedraw) {
+            continue;
+        }
+
+        TSM_TRACE_SCOPE("frame");
+        needsRedraw = false;
+        if (solver.update()) {
+            buildTourGeometry();
+        }
         SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF); // Set draw color to black
         SDL_RenderClear(renderer);
 
         printPoints();
 
+        TSM_TRACE_SCOPE("SDL_RenderPresent");
         SDL_RenderPresent(renderer);
-
-        SDL_Delay(100);
     }
 }
+
+void SDLWindow::requestRedraw() {
+    SDL_Event event{};
+    event.type = redrawEvent;
+    SDL_PushEvent(&event);
+}
+
 void SDLWindow::printPoints() {
+    TSM_TRACE_SCOPE("printPoints");
     if (cities.empty()) {
         std::cerr << "No cities to draw." << std::endl;
         return;
     }
 
+    if (useDensity()) {
+        drawDensity();
+        return;
+    }
+
     // Draw city points
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF); // Set draw color to white
-    for (const auto& [position, rect] : cities) {
-        SDL_RenderFillRect(renderer, &rect);
+    {
+        TSM_TRACE_SCOPE("drawCities");
+        drawLayer(cityLayer, cities);
     }
 
     if (net.empty()) {
@@ -77,209 +190,228 @@ void SDLWindow::printPoints() {
     }
 
     // Draw net points
-    SDL_SetRenderDrawColor(renderer, 0, 255, 0, 255); // Set draw color to green
-    for (const auto& [position, rect] : net) {
-        SDL_RenderFillRect(renderer, &rect);
+    {
+        TSM_TRACE_SCOPE("drawNet");
+        drawLayer(netLayer, net);
     }
 
-    // Create a vector to store the angle and radius for sorting
-    struct PolarPoint {
-        Vector<2> vector;
-        float angle;
-        float radius;
-    };
-    std::vector<PolarPoint> polarPoints;
-
-    // Calculate the center point
-    Vector<2> center = calculateCenter();
-
-    // Calculate angle and radius for each point and store in the vector
-    for (const auto& [cityPos, _] : cities) {
-        Vector<2> closestNetPoint = findClosestPoint(cityPos, net);
-        float dx = closestNetPoint[0] - center[0];
-        float dy = closestNetPoint[1] - center[1];
-        float angle = std::atan2(dy, dx);
-        float radius = std::sqrt(dx * dx + dy * dy);
-        polarPoints.push_back({cityPos, angle, radius});
-    }
+    // Draw the latest published tour as one polyline
+    TSM_TRACE_SCOPE("drawTour");
+    SDL_SetRenderDrawColor(renderer, 0xFF, 0x00, 0x00, 0xFF); // Set draw color to red
+    SDL_RenderDrawLines(renderer, tourPoints.data(), static_cast<int>(tourPoints.size()));
+}
 
-    // Sort the points by angle and then by radius
-    std::sort(polarPoints.begin(), polarPoints.end(), [](const PolarPoint& a, const PolarPoint& b) {
-        if (std::fabs(a.angle - b.angle) < 0.001) { // If angles are very close, sort by radius
-            return a.radius < b.radius;
+void SDLWindow::drawLayer(PointLayer& layer, const PointStore& points) {
+    if (layer.dirty) {
+        layer.rects.clear();
+        appendRects(points, layer.size, layer.offset, layer.rects);
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        layer.vertices.clear();
+        layer.indices.clear();
+        appendQuads(layer.rects, layer.color, layer.vertices, layer.indices);
+#endif
+
+        if (layer.texture == nullptr) {
+            int width = 0;
+            int height = 0;
+            SDL_GetRendererOutputSize(renderer, &width, &height);
+            layer.texture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                              width, height);
+            if (layer.texture != nullptr) {
+                SDL_SetTextureBlendMode(layer.texture, SDL_BLENDMODE_BLEND);
+            }
         }
-        return a.angle < b.angle;
-    });
-
-    // Draw lines between sorted points and connect the last point to the first
-    Vector<2> previousVector;
-    bool isPreviousVectorSet = false;
-    Vector<2> firstVector;
-
-    for (const auto& polarPoint : polarPoints) {
-        if (isPreviousVectorSet) {
-            drawLine(previousVector, polarPoint.vector);
-        } else {
-            firstVector = polarPoint.vector;
+        if (layer.texture != nullptr) {
+            SDL_SetRenderTarget(renderer, layer.texture);
+            SDL_SetRenderDrawColor(renderer, 0, 0, 0, 0);
+            SDL_RenderClear(renderer);
+            submitLayer(layer);
+            SDL_SetRenderTarget(renderer, nullptr);
         }
-
-        previousVector = polarPoint.vector;
-        isPreviousVectorSet = true;
+        layer.dirty = false;
     }
 
-    // Connect the last vector with the first vector
-    if (isPreviousVectorSet) {
-        drawLine(previousVector, firstVector);
+    // Without render target support the batch is submitted every frame instead
+    if (layer.texture != nullptr) {
+        SDL_RenderCopy(renderer, layer.texture, nullptr, nullptr);
+    } else {
+        submitLayer(layer);
     }
 }
 
-Vector<2> SDLWindow::calculateCenter() {
-    float middlePointX = 0.0f;
-    float middlePointY = 0.0f;
+void SDLWindow::submitLayer(const PointLayer& layer) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+    SDL_RenderGeometry(renderer, nullptr, layer.vertices.data(), static_cast<int>(layer.vertices.size()),
+                       layer.indices.data(), static_cast<int>(layer.indices.size()));
+#else
+    SDL_SetRenderDrawColor(renderer, layer.color.r, layer.color.g, layer.color.b, layer.color.a);
+    SDL_RenderFillRects(renderer, layer.rects.data(), static_cast<int>(layer.rects.size()));
+#endif
+}
 
-    for (const auto& entry : cities) {
-        middlePointX += entry.first[0];
-        middlePointY += entry.first[1];
+void SDLWindow::destroyLayers() {
+    for (PointLayer* layer : { &cityLayer, &netLayer }) {
+        if (layer->texture != nullptr) {
+            SDL_DestroyTexture(layer->texture);
+            layer->texture = nullptr;
+        }
+        layer->dirty = true;
     }
-
-    middlePointX /= static_cast<float>(cities.size());
-    middlePointY /= static_cast<float>(cities.size());
-
-    return Vector<2>{middlePointX, middlePointY};
+    if (densityTexture != nullptr) {
+        SDL_DestroyTexture(densityTexture);
+        densityTexture = nullptr;
+    }
+    densityDirty = true;
 }
 
+bool SDLWindow::useDensity() const {
+    if (!densityAvailable) {
+        return false;
+    }
+    // Once the city squares could cover the whole output, most of them are overdraw
+    int width = 0;
+    int height = 0;
+    SDL_GetRendererOutputSize(renderer, &width, &height);
+    const std::size_t cityArea = static_cast<std::size_t>(cityLayer.size) * cityLayer.size;
+    return cities.size() * cityArea > static_cast<std::size_t>(width) * height;
+}
 
+void SDLWindow::drawDensity() {
+    TSM_TRACE_SCOPE("drawDensity");
+    const auto now = std::chrono::steady_clock::now();
+    if (densityTourDirty && !densityDirty && !solver.latest().complete && now < densityTourDue) {
+        // Keep showing the last counted tour and try again on a later frame. Counting a
+        // million edges takes a good part of a second, the final tour goes in at once.
+        needsRedraw = true;
+    } else if (densityDirty || densityTourDirty) {
+        int width = 0;
+        int height = 0;
+        SDL_GetRendererOutputSize(renderer, &width, &height);
+        if (densityTexture == nullptr) {
+            densityTexture = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING,
+                                               width, height);
+            if (densityTexture == nullptr) {
+                std::cerr << "Failed to create density texture: " << SDL_GetError() << std::endl;
+                densityAvailable = false;
+                return;
+            }
+        }
 
-Vector<2> SDLWindow::findClosestPoint(const Vector<2>& source, const std::unordered_map<Vector<2>, SDL_Rect>& targets) {
-    Vector<2> closestPoint;
-    float minDistance = std::numeric_limits<float>::max();
-
-    for (const auto& [targetPos, _] : targets) {
-        if (source == targetPos) continue; // Skip the source point itself
-        float distance = calculateDistance(source, targetPos);
-        if (distance < minDistance) {
-            minDistance = distance;
-            closestPoint = targetPos;
+        // A new tour leaves the points' counts as they are
+        if (densityDirty) {
+            density.reset(width, height);
+            density.addPoints(DensityMap::Cities, cities);
+            density.addPoints(DensityMap::Net, net);
+        } else {
+            density.clear(DensityMap::Tour);
+        }
+        if (!tourPoints.empty()) {
+            density.addPath(DensityMap::Tour, solver.latest().path);
         }
+        density.toArgb(densityPixels);
+        SDL_UpdateTexture(densityTexture, nullptr, densityPixels.data(), width * static_cast<int>(sizeof(std::uint32_t)));
+        densityTourDue = now + (std::chrono::steady_clock::now() - now) * DENSITY_TOUR_BACKOFF;
+        densityDirty = false;
+        densityTourDirty = false;
     }
 
-    return closestPoint;
+    SDL_RenderCopy(renderer, densityTexture, nullptr, nullptr);
 }
 
-void SDLWindow::createNet() {
-    std::vector<Vector<2>> keys;
-
-    for (const auto& entry : cities) {
-        keys.push_back(entry.first);
-    }
-
-    if (keys.empty()) {
-        std::cerr << "No points available to calculate the middle point." << std::endl;
+void SDLWindow::buildTourGeometry() {
+    densityTourDirty = true;
+    const TourSnapshot& snapshot = solver.latest();
+    if (pointsChanged || snapshot.generation < pointsGeneration) {
+        // Solved for points that are gone, wait for the current solve
+        tourPoints.clear();
+        SDL_SetWindowTitle(window, windowTitle.c_str());
+        return;
     }
-
-    float middlePointX = 0.0f;
-    float middlePointY = 0.0f;
-
-    for (const Vector<2>& vector : keys) {
-        middlePointX += vector[0];
-        middlePointY += vector[1];
+    const PointStore& path = snapshot.path;
+    tourPoints.resize(path.size());
+    for (std::size_t i = 0; i < path.size(); ++i) {
+        tourPoints[i] = { static_cast<int>(path.x(i)), static_cast<int>(path.y(i)) };
     }
 
-    middlePointX /= static_cast<float>(keys.size());
-    middlePointY /= static_cast<float>(keys.size());
-
-    Vector<2> middlePoint = Vector<2>{middlePointX, middlePointY};
-
-    createNetPoints(middlePoint);
-}
-
-float SDLWindow::calculateDistance(const Vector<2>& point1, const Vector<2>& point2) {
-    float dx = point1[0] - point2[0];
-    float dy = point1[1] - point2[1];
-    return std::sqrt(dx * dx + dy * dy);
+    // Intermediate tours of a running solve are marked with "..."
+    char status[96];
+    std::snprintf(status, sizeof(status), " - length %.1f (%s%s, %.3f s)", snapshot.length, snapshot.stage,
+                  snapshot.complete ? "" : "...", snapshot.seconds);
+    SDL_SetWindowTitle(window, (windowTitle + status).c_str());
 }
 
-void SDLWindow::createNetPoints(Vector<2> vec) {
-    const int pointSize = 5;
-    const int numPoints = numberOfPoints * 2;
-    const int radiusIncrement = numberOfPoints;
-
-    float angleIncrement = 2 * M_PI / numPoints;
-
-    SDL_Rect pointRect = { static_cast<int>(vec[0]) - pointSize / 2, // Center the point
-                           static_cast<int>(vec[1]) - pointSize / 2,
-                           pointSize,
-                           pointSize };
-    net[vec] = pointRect;
-
-    float radius = 0;
-    int k = 0;
-    for (int j = 0; j < radiusIncrement; ++j) {
-        radius += 50;
-        for (int i = 0; i < numPoints; ++i) {
-            float angle = i * angleIncrement;
-            float x = vec[0] + radius * std::cos(angle);
-            float y = vec[1] + radius * std::sin(angle);
-            SDL_Rect pointRect = { static_cast<int>(x) - pointSize / 2, // Center the point
-                                   static_cast<int>(y) - pointSize / 2,
-                                   pointSize,
-                                   pointSize };
-            Vector<2> newPoint = Vector<2>{x, y};
-            net[newPoint] = pointRect;
-            distanceMap[newPoint] = k + radius;
-            ++k;
-        }
+void SDLWindow::submitSolve() {
+    tourStale = false;
+    // Like drawing, the tour needs the net
+    if (net.empty()) {
+        return;
     }
-}
-
-void SDLWindow::createPoints() {
-    double coverPercentage = 0.99;
-    double upperBoundWidth = SCREEN_WIDTH * coverPercentage;
-    double upperBoundHeight = SCREEN_HEIGHT * coverPercentage;
-
-    SDL_SetRenderDrawColor(renderer, 0x00, 0x00, 0x00, 0xFF); // Set draw color to black
-    SDL_RenderClear(renderer);
-
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0xFF, 0xFF, 0xFF); // Set draw color to white
-
-    const int pointSize = 8;
-
-    for (int i = 0; i < numberOfPoints; ++i) {
-        double randomX = (rand() / (double)RAND_MAX) * upperBoundWidth;
-        double randomY = (rand() / (double)RAND_MAX) * upperBoundHeight;
-
-        Vector<2> position = Vector<2>{randomX, randomY};
-        SDL_Rect pointRect = { static_cast<int>(randomX), static_cast<int>(randomY), pointSize, pointSize };
-
-        cities[position] = pointRect;
-
-        SDL_RenderFillRect(renderer, &pointRect);
+    std::uint64_t generation = solver.solve(cities, net, solverOptions);
+    if (pointsChanged) {
+        pointsChanged = false;
+        pointsGeneration = generation;
+        buildTourGeometry();
+        needsRedraw = true;
     }
-
-    SDL_RenderPresent(renderer);
 }
 
-void SDLWindow::drawLine(Vector<2> vec1, Vector<2> vec2) {
-    float vec1x = vec1[0];
-    float vec1y = vec1[1];
-    float vec2x = vec2[0];
-    float vec2y = vec2[1];
-
-    SDL_SetRenderDrawColor(renderer, 0xFF, 0x00, 0x00, 0xFF); // Set draw color to red
+void SDLWindow::createNet() {
+    net = ::createNet(cities, numberOfPoints);
+    netLayer.dirty = true;
+    densityDirty = true;
+    tourStale = true;
+    pointsChanged = true;
+    needsRedraw = true;
+}
 
-    SDL_RenderDrawLine(renderer, static_cast<int>(vec1x), static_cast<int>(vec1y),
-                       static_cast<int>(vec2x), static_cast<int>(vec2y));
+void SDLWindow::createPoints() {
+    cities = ::createPoints(numberOfPoints, SCREEN_WIDTH, SCREEN_HEIGHT, seed);
+    cityLayer.dirty = true;
+    densityDirty = true;
+    tourStale = true;
+    pointsChanged = true;
+    needsRedraw = true;
 }
 
-void SDLWindow::handleEvents() {
-    SDL_Event event;
-    while (SDL_PollEvent(&event) != 0) {
-        if (event.type == SDL_QUIT) {
+void SDLWindow::handleEvent(const SDL_Event& event) {
+    if (event.type == SDL_QUIT) {
+        quit = true;
+    } else if (event.type == SDL_KEYDOWN) {
+        if (event.key.keysym.sym == SDLK_q) {
             quit = true;
-        } else if (event.type == SDL_KEYDOWN) {
-            if (event.key.keysym.sym == SDLK_q) {
-                quit = true;
+        } else if (event.key.keysym.sym == SDLK_e) {
+            // Cycle through the tour constructions, skipping the slow ones on large instances
+            const std::vector<SolverMode>& modes = solverModes();
+            auto current = std::find(modes.begin(), modes.end(), solverOptions.mode);
+            do {
+                current = current + 1 < modes.end() ? current + 1 : modes.begin();
+            } while (solverModeIsQuadratic(*current) && cities.size() > MAX_QUADRATIC_CITIES);
+            solverOptions.mode = *current;
+            tourStale = true;
+        } else if (event.key.keysym.sym == SDLK_t) {
+            // Cycle the improvement pass over the constructed tour: none, 2-opt, Lin-Kernighan,
+            // parallel 2-opt
+            switch (solverOptions.improvement) {
+                case Improvement::None: solverOptions.improvement = Improvement::TwoOpt; break;
+                case Improvement::TwoOpt: solverOptions.improvement = Improvement::LinKernighan; break;
+                case Improvement::LinKernighan: solverOptions.improvement = Improvement::ParallelTwoOpt; break;
+                default: solverOptions.improvement = Improvement::None; break;
             }
+            tourStale = true;
+        }
+    } else if (event.type == SDL_WINDOWEVENT) {
+        if (event.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
+            // The layer textures match the output size, recreate them
+            destroyLayers();
+            needsRedraw = true;
+        } else if (event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+            needsRedraw = true;
         }
+    } else if (event.type == SDL_RENDER_TARGETS_RESET || event.type == SDL_RENDER_DEVICE_RESET) {
+        // Texture contents, or the textures themselves, are lost
+        destroyLayers();
+        needsRedraw = true;
+    } else if (event.type == redrawEvent) {
+        needsRedraw = true;
     }
 }
@@ -1,39 +1,96 @@
 #pragma once
 
-#include <map>
 #include <SDL.h>
-#include <unordered_map>
+#include "DensityMap.h"
+#include "PointStore.h"
+#include "Solver.h"
+#include "SolverThread.h"
 #include "Vector.h"
+#include <chrono>
+#include <cstdint>
+#include <string>
 #include <vector>
 
 class SDLWindow {
 public:
     SDLWindow(const char* title, double width, double height);
     ~SDLWindow();
+    // Show a TSPLIB instance instead of random cities. Returns false if it cannot be read.
+    bool loadInstance(const char* path);
     void start();
+    // Wake the event loop for a redraw. Safe to call from any thread.
+    void requestRedraw();
 
 private:
+    // A layer of equally sized points. It is drawn once into its own texture and
+    // composited from there until its points change.
+    struct PointLayer {
+        int size;
+        int offset;
+        SDL_Color color;
+        std::vector<SDL_Rect> rects;
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        std::vector<SDL_Vertex> vertices;
+        std::vector<int> indices;
+#endif
+        SDL_Texture* texture = nullptr;
+        bool dirty = true;
+    };
+
     void createPoints();
     void createNet();
     void printPoints();
-    void drawLine(Vector<2> vec1, Vector<2> vec2);
-    void handleEvents();
-    void createNetPoints(Vector<2>);
-    float calculateDistance(const Vector<2>& point1, const Vector<2>& point2);
-    Vector<2> findClosestPoint(const Vector<2>& source, const std::unordered_map<Vector<2>, SDL_Rect>& targets);
-    Vector<2> calculateCenter();
+    void drawLayer(PointLayer& layer, const PointStore& points);
+    void submitLayer(const PointLayer& layer);
+    void destroyLayers();
+    bool useDensity() const;
+    void drawDensity();
+    void buildTourGeometry();
+    void submitSolve();
+    void handleEvent(const SDL_Event& event);
 
 
     SDL_Window* window;
+    // The tour's length and progress are appended to it
+    std::string windowTitle;
     SDL_Renderer* renderer;
     // Change value to play around
     int numberOfPoints = 30;
     bool quit;
     double SCREEN_WIDTH;
     double SCREEN_HEIGHT;
-    std::unordered_map<Vector<2>, SDL_Rect> cities;
-    std::unordered_map<Vector<2>, SDL_Rect> net;
-    std::map<Vector<2>, int> distanceMap;
-    std::map<int, Vector<2>> orderedMap;
-    std::vector<Vector<2>> vectorList;
+    unsigned seed;
+    PointStore cities;
+    PointStore net;
+    SolverOptions solverOptions;
+
+    // Set by anything that changes what is on screen, the loop only draws then
+    bool needsRedraw = true;
+    // Registered SDL event type posted by requestRedraw
+    Uint32 redrawEvent = 0;
+    PointLayer cityLayer{8, 0, {0xFF, 0xFF, 0xFF, 0xFF}};
+    PointLayer netLayer{5, 2, {0, 255, 0, 255}}; // Centered on the net points
+    std::vector<SDL_Point> tourPoints;
+
+    // Tours are solved in the background, each frame draws the latest published one
+    SolverThread solver;
+    // The points or solver options changed since the last solve was submitted
+    bool tourStale = true;
+    // The points changed since then, older tours show other points
+    bool pointsChanged = true;
+    // First solve generation for the current points
+    std::uint64_t pointsGeneration = 0;
+
+    // Level of detail for instances whose points would mostly overdraw each other:
+    // everything is binned into a density map and shown as one streaming texture
+    DensityMap density;
+    std::vector<std::uint32_t> densityPixels;
+    SDL_Texture* densityTexture = nullptr;
+    bool densityDirty = true;
+    // Only the tour changed since, the points' counts still hold
+    bool densityTourDirty = false;
+    // Intermediate tours are not counted before then, see DENSITY_TOUR_BACKOFF
+    std::chrono::steady_clock::time_point densityTourDue;
+    // Cleared if the streaming texture cannot be created, exact drawing is used then
+    bool densityAvailable = true;
 };
@@ -0,0 +1,186 @@
+#include "Solver.h"
+#include "Christofides.h"
+#include "GreedyEdge.h"
+#include "Insertion.h"
+#include "NearestNeighbour.h"
+#include "Trace.h"
+#include <algorithm>
+#include <chrono>
+#include <limits>
+
+const char* solverModeName(SolverMode mode) {
+    switch (mode) {
+        case SolverMode::ElasticNet: return "elastic-net";
+        case SolverMode::SpaceFillingCurve: return "space-filling-curve";
+        case SolverMode::GreedyEdge: return "greedy-edge";
+        case SolverMode::NearestNeighbour: return "nearest-neighbour";
+        case SolverMode::FarthestInsertion: return "farthest-insertion";
+        case SolverMode::CheapestInsertion: return "cheapest-insertion";
+        case SolverMode::Christofides: return "christofides";
+        default: return "polar-sort";
+    }
+}
+
+const std::vector<SolverMode>& solverModes() {
+    static const std::vector<SolverMode> modes = {
+        SolverMode::PolarSort,         SolverMode::ElasticNet,        SolverMode::SpaceFillingCurve,
+        SolverMode::GreedyEdge,        SolverMode::NearestNeighbour,  SolverMode::FarthestInsertion,
+        SolverMode::CheapestInsertion, SolverMode::Christofides};
+    return modes;
+}
+
+const char* solverModeComplexity(SolverMode mode) {
+    switch (mode) {
+        case SolverMode::ElasticNet: return "O(n) time per iteration, O(n) memory";
+        case SolverMode::SpaceFillingCurve: return "O(n) time, O(n) memory";
+        case SolverMode::GreedyEdge: return "O(n k log n) time, O(n k) memory";
+        case SolverMode::NearestNeighbour: return "O(n) expected, O(n^2) worst time, O(n) memory";
+        case SolverMode::FarthestInsertion: return "O(n^2) time, O(n) memory";
+        case SolverMode::CheapestInsertion: return "O(n^2) expected time, O(n) memory";
+        case SolverMode::Christofides: return "O(n k log n) time, O(n k) memory";
+        default: return "O(n log n) time, O(n) memory";
+    }
+}
+
+bool solverModeIsQuadratic(SolverMode mode) {
+    return mode == SolverMode::FarthestInsertion || mode == SolverMode::CheapestInsertion;
+}
+
+const char* improvementName(Improvement improvement) {
+    switch (improvement) {
+        case Improvement::TwoOpt: return "2-opt";
+        case Improvement::LinKernighan: return "lin-kernighan";
+        case Improvement::ParallelTwoOpt: return "parallel-2-opt";
+        default: return "none";
+    }
+}
+
+Tour constructTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex,
+                   const SolverOptions& options) {
+    const Deadline deadline(options.timeLimitSeconds, options.constructionStop);
+    switch (options.mode) {
+        case SolverMode::ElasticNet:
+            return solveElasticNet(cities, options.elasticNet).tour;
+        case SolverMode::SpaceFillingCurve:
+            return buildCurveTour(cities, options.curve);
+        case SolverMode::GreedyEdge:
+            return buildGreedyEdgeTour(cities, options.constructionNeighbours, deadline);
+        case SolverMode::NearestNeighbour:
+            return buildNearestNeighbourTour(cities, 0, deadline);
+        case SolverMode::FarthestInsertion:
+            return buildInsertionTour(cities, InsertionRule::Farthest, deadline);
+        case SolverMode::CheapestInsertion:
+            return buildInsertionTour(cities, InsertionRule::Cheapest, deadline);
+        case SolverMode::Christofides:
+            return buildChristofidesTour(cities, options.constructionNeighbours, deadline);
+        default:
+            return buildPolarTour(cities, net, netIndex);
+    }
+}
+
+namespace {
+
+// lists itself if it has no more than k candidates per city, else its first k in narrowed
+const NeighbourLists& narrow(const NeighbourLists& lists, std::size_t k, NeighbourLists& narrowed) {
+    if (k >= lists.perCity()) {
+        return lists;
+    }
+    narrowed = NeighbourLists(lists, k);
+    return narrowed;
+}
+
+bool stopped(const std::atomic<bool>* stop) {
+    return stop != nullptr && stop->load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+Tour solveTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex,
+               const SolverOptions& options) {
+    TSM_TRACE_SCOPE("solveTour");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+    auto remaining = [&] { return options.timeLimitSeconds - elapsed(); };
+
+    double reportedLength = std::numeric_limits<double>::infinity();
+    auto report = [&](const Tour& tour, double length, const char* stage) {
+        if (options.progress && length < reportedLength) {
+            reportedLength = length;
+            options.progress(SolverProgress{tour, length, elapsed(), stage});
+        }
+    };
+
+    SolverOptions construction = options;
+    construction.timeLimitSeconds = remaining();
+    construction.elasticNet.timeLimitSeconds = std::min(options.elasticNet.timeLimitSeconds, remaining());
+    Tour tour = constructTour(cities, net, netIndex, construction);
+    if (options.progress) {
+        report(tour, tourLength(cities, tour), solverModeName(options.mode));
+    }
+    if (options.improvement == Improvement::None || remaining() <= 0.0) {
+        return tour;
+    }
+
+    if (options.improvement == Improvement::ParallelTwoOpt) {
+        if (stopped(options.parallelTwoOpt.stop)) {
+            return tour;
+        }
+        const char* stage = improvementName(Improvement::ParallelTwoOpt);
+        NeighbourLists neighbours;
+        if (!neighbours.build(cities, options.parallelTwoOpt.neighbours,
+                              Deadline(remaining(), options.parallelTwoOpt.stop))) {
+            return tour;
+        }
+        ParallelTwoOptOptions parallelTwoOpt = options.parallelTwoOpt;
+        parallelTwoOpt.timeLimitSeconds = std::min(parallelTwoOpt.timeLimitSeconds, remaining());
+        if (options.progress) {
+            parallelTwoOpt.progress = [&](const Tour& current, double length) { report(current, length, stage); };
+        }
+        ImprovementReport parallelReport = improveParallelTwoOpt(cities, tour, neighbours, parallelTwoOpt);
+        report(tour, parallelReport.finalLength, stage);
+        return tour;
+    }
+
+    if (stopped(options.twoOpt.stop)) {
+        return tour;
+    }
+
+    // 2-opt also runs ahead of Lin-Kernighan: it is much cheaper per move and removes
+    // most of the construction's slack. Both passes search the same candidates,
+    // Lin-Kernighan the nearest of them.
+    const std::size_t candidates = options.improvement == Improvement::LinKernighan
+                                       ? std::max(options.twoOpt.neighbours, options.linKernighan.neighbours)
+                                       : options.twoOpt.neighbours;
+    NeighbourLists neighbours;
+    if (!neighbours.build(cities, candidates, Deadline(remaining(), options.twoOpt.stop))) {
+        return tour;
+    }
+    NeighbourLists narrowed;
+
+    const char* twoOptStage = improvementName(Improvement::TwoOpt);
+    TwoOptOptions twoOpt = options.twoOpt;
+    twoOpt.timeLimitSeconds = std::min(twoOpt.timeLimitSeconds, remaining());
+    if (options.progress) {
+        twoOpt.progress = [&](const Tour& current, double length) { report(current, length, twoOptStage); };
+    }
+    ImprovementReport twoOptReport =
+        improveTwoOpt(cities, tour, narrow(neighbours, twoOpt.neighbours, narrowed), twoOpt);
+    report(tour, twoOptReport.finalLength, twoOptStage);
+    if (options.improvement != Improvement::LinKernighan || remaining() <= 0.0 ||
+        stopped(options.linKernighan.stop)) {
+        return tour;
+    }
+
+    const char* linKernighanStage = improvementName(Improvement::LinKernighan);
+    LinKernighanOptions linKernighan = options.linKernighan;
+    linKernighan.timeLimitSeconds = std::min(linKernighan.timeLimitSeconds, remaining());
+    if (options.progress) {
+        linKernighan.progress = [&](const Tour& current, double length) { report(current, length, linKernighanStage); };
+    }
+    ImprovementReport linKernighanReport =
+        improveLinKernighan(cities, tour, narrow(neighbours, linKernighan.neighbours, narrowed), linKernighan);
+    report(tour, linKernighanReport.finalLength, linKernighanStage);
+    return tour;
+}
@@ -0,0 +1,110 @@
+#ifndef SOLVER_H
+#define SOLVER_H
+
+#include "ElasticNet.h"
+#include "LinKernighan.h"
+#include "ParallelTwoOpt.h"
+#include "PointStore.h"
+#include "RingNetIndex.h"
+#include "SpaceFillingCurve.h"
+#include "Tour.h"
+#include "TwoOpt.h"
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <vector>
+
+// Tour construction strategy. solverModeComplexity() gives each one's cost, the
+// comments of the functions they call how good their tours tend to be.
+enum class SolverMode {
+    // Angle sort of the cities' projections onto the static net
+    PolarSort,
+    // Iterative Durbin-Willshaw elastic net
+    ElasticNet,
+    // Radix sort of the cities' positions along a Hilbert or Moore curve
+    SpaceFillingCurve,
+    // Candidate edges taken shortest first, fragments joined nearest end first
+    GreedyEdge,
+    // Walk to the closest unvisited city through a grid
+    NearestNeighbour,
+    // Insert the city farthest from the tour where it costs least
+    FarthestInsertion,
+    // Insert the city that costs least
+    CheapestInsertion,
+    // Spanning tree, matching of its odd cities and a shortcut Euler circuit
+    Christofides
+};
+
+enum class Improvement {
+    None,
+    // Neighbour-list 2-opt with don't-look bits
+    TwoOpt,
+    // 2-opt followed by Lin-Kernighan with 3-opt steps
+    LinKernighan,
+    // 2-opt and Or-opt on tour segments in parallel
+    ParallelTwoOpt
+};
+
+// A tour reported while solveTour runs.
+struct SolverProgress {
+    // Only valid during the callback
+    const Tour& tour;
+    double length;
+    // Since solveTour was called
+    double seconds;
+    // solverModeName() after construction, improvementName() of the running pass after that
+    const char* stage;
+};
+
+using SolverCallback = std::function<void(const SolverProgress& progress)>;
+
+struct SolverOptions {
+    SolverMode mode = SolverMode::PolarSort;
+    Improvement improvement = Improvement::TwoOpt;
+    ElasticNetOptions elasticNet;
+    // Curve followed by SpaceFillingCurve
+    CurveType curve = CurveType::Hilbert;
+    // Candidate neighbours per city of GreedyEdge and Christofides
+    std::size_t constructionNeighbours = 10;
+    // Checked along with timeLimitSeconds by the constructions after SpaceFillingCurve,
+    // which return a worse but whole tour once it is set. ElasticNet uses its own.
+    const std::atomic<bool>* constructionStop = nullptr;
+    TwoOptOptions twoOpt;
+    LinKernighanOptions linKernighan;
+    ParallelTwoOptOptions parallelTwoOpt;
+    // Wall-clock budget of the whole solve. Every phase is capped to what is left of it,
+    // and phases that would start after it ran out are skipped.
+    double timeLimitSeconds = std::numeric_limits<double>::infinity();
+    // Called with every tour shorter than the ones before: the constructed one, the
+    // improving passes' intermediate tours (see their progressSeconds) and each pass's
+    // result. Replaces the passes' own progress callbacks.
+    SolverCallback progress;
+};
+
+const char* solverModeName(SolverMode mode);
+const char* improvementName(Improvement improvement);
+
+// Every SolverMode in declaration order, for picking one by name or trying them all
+const std::vector<SolverMode>& solverModes();
+
+// Time and memory of the mode's construction for n cities, k candidates per city,
+// e.g. "O(n log n) time, O(n) memory"
+const char* solverModeComplexity(SolverMode mode);
+
+// True for the constructions that take O(n^2) time, seconds from about 10^4 cities on
+bool solverModeIsQuadratic(SolverMode mode);
+
+// The construction half of solveTour: the tour options.mode builds, unimproved.
+// net and netIndex are only used by PolarSort. Stops early on timeLimitSeconds and
+// constructionStop, see Deadline.
+Tour constructTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex,
+                   const SolverOptions& options);
+
+// Build a tour with the selected solver, then run the selected improvement on it.
+// Anytime: the construction gives a usable tour quickly, the improvement keeps
+// shortening it, and the best tour so far is returned once the budget is spent.
+// net and netIndex are only used by PolarSort.
+Tour solveTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex,
+               const SolverOptions& options);
+
+#endif // SOLVER_H
@@ -0,0 +1,99 @@
+#include "SolverThread.h"
+#include "RingNetIndex.h"
+#include "Trace.h"
+#include <chrono>
+#include <utility>
+
+SolverThread::SolverThread(std::function<void()> notify)
+    : notify(std::move(notify)), worker([this] { run(); }) {}
+
+SolverThread::~SolverThread() {
+    stop();
+}
+
+std::uint64_t SolverThread::solve(const PointStore& cities, const PointStore& net, const SolverOptions& options) {
+    // Copy outside the lock, the caller may change its points while this job runs
+    auto job = std::make_unique<Job>(Job{0, cities, net, options});
+    std::lock_guard<std::mutex> lock(mutex);
+    job->generation = ++submitted;
+    pending = std::move(job);
+    cancel.store(true, std::memory_order_relaxed);
+    wakeUp.notify_one();
+    return submitted;
+}
+
+void SolverThread::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+        cancel.store(true, std::memory_order_relaxed);
+    }
+    wakeUp.notify_one();
+    if (worker.joinable()) {
+        worker.join();
+    }
+}
+
+void SolverThread::run() {
+    setTraceThreadName("solver");
+    for (;;) {
+        std::unique_ptr<Job> job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wakeUp.wait(lock, [this] { return stopping || pending != nullptr; });
+            if (stopping) {
+                return;
+            }
+            job = std::move(pending);
+            cancel.store(false, std::memory_order_relaxed);
+        }
+
+        SolverOptions options = job->options;
+        options.twoOpt.stop = &cancel;
+        options.linKernighan.stop = &cancel;
+        options.parallelTwoOpt.stop = &cancel;
+        options.constructionStop = &cancel;
+        options.elasticNet.stop = &cancel;
+        const char* stage = solverModeName(options.mode);
+        options.progress = [&](const SolverProgress& progress) {
+            stage = progress.stage;
+            if (!cancel.load(std::memory_order_relaxed)) {
+                publish(*job, progress.tour, progress.length, progress.seconds, progress.stage, false);
+            }
+        };
+        auto start = std::chrono::steady_clock::now();
+        RingNetIndex netIndex(job->net);
+        Tour tour = solveTour(job->cities, job->net, netIndex, options);
+        if (cancel.load(std::memory_order_relaxed)) {
+            // Cut short for a newer job or shutdown, nobody wants this tour
+            continue;
+        }
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        publish(*job, tour, tourLength(job->cities, tour), seconds, stage, true);
+    }
+}
+
+void SolverThread::publish(const Job& job, const Tour& tour, double length, double seconds, const char* stage,
+                           bool complete) {
+    TourSnapshot& snapshot = snapshots.back();
+    snapshot.generation = job.generation;
+    snapshot.tour = tour;
+    snapshot.length = length;
+    snapshot.seconds = seconds;
+    snapshot.stage = stage;
+    snapshot.complete = complete;
+    snapshot.path.clear();
+    if (!tour.empty()) {
+        const PointStore& cities = job.cities;
+        snapshot.path.reserve(tour.size() + 1);
+        for (PointId city : tour) {
+            snapshot.path.add(cities.x(city), cities.y(city), cities.id(city));
+        }
+        PointId first = tour.front();
+        snapshot.path.add(cities.x(first), cities.y(first), cities.id(first));
+    }
+    snapshots.publish();
+    if (notify) {
+        notify();
+    }
+}
@@ -0,0 +1,82 @@
+#ifndef SOLVERTHREAD_H
+#define SOLVERTHREAD_H
+
+#include "PointStore.h"
+#include "Solver.h"
+#include "Tour.h"
+#include "TripleBuffer.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+// A tour published by the solver thread, with its path ready for drawing.
+struct TourSnapshot {
+    // solve() call the tour belongs to, 0 before anything was published
+    std::uint64_t generation = 0;
+    Tour tour;
+    // City positions in tour order with the first city repeated at the end,
+    // so consecutive entries form the closed edge list.
+    PointStore path;
+    double length = 0.0;
+    double seconds = 0.0;
+    // Stage that produced the tour, see SolverProgress
+    const char* stage = "";
+    // False while the solve is still improving on this tour
+    bool complete = false;
+};
+
+// Runs solveTour on its own thread so the caller never blocks on a solve. Every tour the
+// solve reports is published, so the reader sees the construction within milliseconds
+// and then each improvement. Results go through a triple buffer: the solver never waits
+// for the reader, and the reader picks up the newest tour at any time without locking.
+class SolverThread {
+public:
+    // notify runs on the solver thread after every publish, e.g. to wake an event loop
+    explicit SolverThread(std::function<void()> notify = nullptr);
+    ~SolverThread();
+
+    SolverThread(const SolverThread&) = delete;
+    SolverThread& operator=(const SolverThread&) = delete;
+
+    // Solve copies of cities and net. Replaces a job that has not started yet and stops
+    // the running one early. Returns the generation its snapshots will carry.
+    // options.progress is replaced by the publishing.
+    std::uint64_t solve(const PointStore& cities, const PointStore& net, const SolverOptions& options);
+
+    // Stop the running job and join the thread, nothing is published afterwards
+    void stop();
+
+    // Reader side, from one thread only: adopt the newest published snapshot.
+    // Returns true if latest() changed.
+    bool update() { return snapshots.update(); }
+    const TourSnapshot& latest() const { return snapshots.front(); }
+
+private:
+    struct Job {
+        std::uint64_t generation;
+        PointStore cities;
+        PointStore net;
+        SolverOptions options;
+    };
+
+    void run();
+    void publish(const Job& job, const Tour& tour, double length, double seconds, const char* stage, bool complete);
+
+    std::function<void()> notify;
+    std::mutex mutex;
+    std::condition_variable wakeUp;
+    std::unique_ptr<Job> pending;
+    std::uint64_t submitted = 0;
+    bool stopping = false;
+    // Set to abandon the running job, for a newer one or for shutdown
+    std::atomic<bool> cancel{false};
+    TripleBuffer<TourSnapshot> snapshots;
+    // Last, so it starts once everything it uses exists
+    std::thread worker;
+};
+
+#endif // SOLVERTHREAD_H
@@ -0,0 +1,316 @@
+#include "SpaceFillingCurve.h"
+#include "DistanceKernels.h"
+#include "RadixSort.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <limits>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define TSM_X86_DISPATCH 1
+#include <immintrin.h>
+#define TSM_TARGET(isa) __attribute__((target(isa)))
+// Keeps the scalar tail out of the AVX2 kernel, see DistanceKernels.cpp
+#define TSM_SCALAR __attribute__((noinline))
+#else
+#define TSM_X86_DISPATCH 0
+#define TSM_SCALAR
+#endif
+
+const char* curveTypeName(CurveType curve) {
+    switch (curve) {
+        case CurveType::Moore: return "moore";
+        default: return "hilbert";
+    }
+}
+
+namespace {
+
+constexpr std::uint32_t gridMask = 0xFFFF;
+// Side of a Moore quadrant's Hilbert curve, minus one
+constexpr std::uint32_t halfMask = 0x7FFF;
+
+// Spread the low 16 bits of x to the even bit positions
+std::uint32_t interleaveBits(std::uint32_t x) {
+    x = (x | (x << 8)) & 0x00FF00FF;
+    x = (x | (x << 4)) & 0x0F0F0F0F;
+    x = (x | (x << 2)) & 0x33333333;
+    x = (x | (x << 1)) & 0x55555555;
+    return x;
+}
+
+} // namespace
+
+// Every level's bit pair picks a quadrant and hands a transformation (swap and
+// complement of the axes) down to the levels below it. Instead of walking the levels
+// one by one, the composed transformations of all 16 levels come out of a prefix scan
+// in log2(16) steps over the bit planes A-D, and the key bits follow from them.
+std::uint32_t hilbertKey(std::uint32_t x, std::uint32_t y) {
+    x &= gridMask;
+    y &= gridMask;
+    std::uint32_t A, B, C, D;
+    {
+        std::uint32_t a = x ^ y;
+        std::uint32_t b = gridMask ^ a;
+        std::uint32_t c = gridMask ^ (x | y);
+        std::uint32_t d = x & (y ^ gridMask);
+        A = a | (b >> 1);
+        B = (a >> 1) ^ a;
+        C = ((c >> 1) ^ (b & (d >> 1))) ^ c;
+        D = ((a & (c >> 1)) ^ (d >> 1)) ^ d;
+    }
+    {
+        std::uint32_t a = A, b = B, c = C, d = D;
+        A = (a & (a >> 2)) ^ (b & (b >> 2));
+        B = (a & (b >> 2)) ^ (b & ((a ^ b) >> 2));
+        C ^= (a & (c >> 2)) ^ (b & (d >> 2));
+        D ^= (b & (c >> 2)) ^ ((a ^ b) & (d >> 2));
+    }
+    {
+        std::uint32_t a = A, b = B, c = C, d = D;
+        A = (a & (a >> 4)) ^ (b & (b >> 4));
+        B = (a & (b >> 4)) ^ (b & ((a ^ b) >> 4));
+        C ^= (a & (c >> 4)) ^ (b & (d >> 4));
+        D ^= (b & (c >> 4)) ^ ((a ^ b) & (d >> 4));
+    }
+    {
+        std::uint32_t a = A, b = B, c = C, d = D;
+        C ^= (a & (c >> 8)) ^ (b & (d >> 8));
+        D ^= (b & (c >> 8)) ^ ((a ^ b) & (d >> 8));
+    }
+    std::uint32_t a = C ^ (C >> 1);
+    std::uint32_t b = D ^ (D >> 1);
+    std::uint32_t i0 = x ^ y;
+    std::uint32_t i1 = b | (gridMask ^ (i0 | a));
+    return (interleaveBits(i1) << 1) | interleaveBits(i0);
+}
+
+// The quadrants are visited bottom left, top left, top right, bottom right, each by
+// an order 15 Hilbert curve turned so it enters next to where the previous one left.
+// The bottom left quarter of the order 16 curve is an order 15 curve with its axes
+// swapped, which is why hilbertKey gets the local coordinates as (y, x).
+std::uint32_t mooreKey(std::uint32_t x, std::uint32_t y) {
+    x &= gridMask;
+    y &= gridMask;
+    std::uint32_t right = 0u - (x >> 15);
+    std::uint32_t u = x & halfMask;
+    std::uint32_t v = y & halfMask;
+    std::uint32_t localX = (v & ~right) | ((halfMask - v) & right);
+    std::uint32_t localY = ((halfMask - u) & ~right) | (u & right);
+    std::uint32_t quadrant = (y >> 15) ^ (right & 3);
+    return (quadrant << 30) | hilbertKey(localY, localX);
+}
+
+namespace {
+
+// Square grid over the cities' bounding box, cell = (coordinate - min) * scale
+struct Grid {
+    float minX;
+    float minY;
+    float scale;
+};
+
+// keys[i] = curve key of city firstId + i in the high half, firstId + i in the low half
+using CurveKernel = void (*)(const float* xs, const float* ys, std::size_t count, const Grid& grid,
+                             CurveType curve, PointId firstId, std::uint64_t* keys);
+
+std::uint32_t gridCell(float value, float min, float scale) {
+    int cell = static_cast<int>((value - min) * scale);
+    return static_cast<std::uint32_t>(std::clamp(cell, 0, static_cast<int>(gridMask)));
+}
+
+TSM_SCALAR void curveKeysScalar(const float* xs, const float* ys, std::size_t count, const Grid& grid,
+                                CurveType curve, PointId firstId, std::uint64_t* keys) {
+    for (std::size_t i = 0; i < count; ++i) {
+        std::uint32_t x = gridCell(xs[i], grid.minX, grid.scale);
+        std::uint32_t y = gridCell(ys[i], grid.minY, grid.scale);
+        std::uint32_t key = curve == CurveType::Moore ? mooreKey(x, y) : hilbertKey(x, y);
+        keys[i] = (std::uint64_t{key} << 32) | (firstId + static_cast<PointId>(i));
+    }
+}
+
+#if TSM_X86_DISPATCH
+
+// The AVX2 versions below follow the scalar ones above line by line, eight keys at a
+// time. Integer only past the grid conversion, so they produce the same keys.
+
+TSM_TARGET("avx2") inline __m256i interleaveBits8(__m256i x) {
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 8)), _mm256_set1_epi32(0x00FF00FF));
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 4)), _mm256_set1_epi32(0x0F0F0F0F));
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 2)), _mm256_set1_epi32(0x33333333));
+    x = _mm256_and_si256(_mm256_or_si256(x, _mm256_slli_epi32(x, 1)), _mm256_set1_epi32(0x55555555));
+    return x;
+}
+
+// One prefix scan step over the bit planes, shift being 2 or 4
+template <int shift>
+TSM_TARGET("avx2") inline void hilbertScan8(__m256i& A, __m256i& B, __m256i& C, __m256i& D) {
+    __m256i a = A, b = B, c = C, d = D;
+    __m256i ab = _mm256_xor_si256(a, b);
+    A = _mm256_xor_si256(_mm256_and_si256(a, _mm256_srli_epi32(a, shift)),
+                         _mm256_and_si256(b, _mm256_srli_epi32(b, shift)));
+    B = _mm256_xor_si256(_mm256_and_si256(a, _mm256_srli_epi32(b, shift)),
+                         _mm256_and_si256(b, _mm256_srli_epi32(ab, shift)));
+    C = _mm256_xor_si256(C, _mm256_xor_si256(_mm256_and_si256(a, _mm256_srli_epi32(c, shift)),
+                                             _mm256_and_si256(b, _mm256_srli_epi32(d, shift))));
+    D = _mm256_xor_si256(D, _mm256_xor_si256(_mm256_and_si256(b, _mm256_srli_epi32(c, shift)),
+                                             _mm256_and_si256(ab, _mm256_srli_epi32(d, shift))));
+}
+
+TSM_TARGET("avx2") inline __m256i hilbertKey8(__m256i x, __m256i y) {
+    const __m256i mask = _mm256_set1_epi32(static_cast<int>(gridMask));
+    __m256i A, B, C, D;
+    {
+        __m256i a = _mm256_xor_si256(x, y);
+        __m256i b = _mm256_xor_si256(mask, a);
+        __m256i c = _mm256_xor_si256(mask, _mm256_or_si256(x, y));
+        __m256i d = _mm256_andnot_si256(y, x);
+        A = _mm256_or_si256(a, _mm256_srli_epi32(b, 1));
+        B = _mm256_xor_si256(_mm256_srli_epi32(a, 1), a);
+        C = _mm256_xor_si256(_mm256_xor_si256(_mm256_srli_epi32(c, 1), _mm256_and_si256(b, _mm256_srli_epi32(d, 1))), c);
+        D = _mm256_xor_si256(_mm256_xor_si256(_mm256_and_si256(a, _mm256_srli_epi32(c, 1)), _mm256_srli_epi32(d, 1)), d);
+    }
+    hilbertScan8<2>(A, B, C, D);
+    hilbertScan8<4>(A, B, C, D);
+    {
+        __m256i a = A, b = B, c = C, d = D;
+        __m256i ab = _mm256_xor_si256(a, b);
+        C = _mm256_xor_si256(C, _mm256_xor_si256(_mm256_and_si256(a, _mm256_srli_epi32(c, 8)),
+                                                 _mm256_and_si256(b, _mm256_srli_epi32(d, 8))));
+        D = _mm256_xor_si256(D, _mm256_xor_si256(_mm256_and_si256(b, _mm256_srli_epi32(c, 8)),
+                                                 _mm256_and_si256(ab, _mm256_srli_epi32(d, 8))));
+    }
+    __m256i a = _mm256_xor_si256(C, _mm256_srli_epi32(C, 1));
+    __m256i b = _mm256_xor_si256(D, _mm256_srli_epi32(D, 1));
+    __m256i i0 = _mm256_xor_si256(x, y);
+    __m256i i1 = _mm256_or_si256(b, _mm256_xor_si256(mask, _mm256_or_si256(i0, a)));
+    return _mm256_or_si256(_mm256_slli_epi32(interleaveBits8(i1), 1), interleaveBits8(i0));
+}
+
+TSM_TARGET("avx2") inline __m256i mooreKey8(__m256i x, __m256i y) {
+    const __m256i half = _mm256_set1_epi32(static_cast<int>(halfMask));
+    __m256i right = _mm256_sub_epi32(_mm256_setzero_si256(), _mm256_srli_epi32(x, 15));
+    __m256i u = _mm256_and_si256(x, half);
+    __m256i v = _mm256_and_si256(y, half);
+    __m256i localX = _mm256_blendv_epi8(v, _mm256_sub_epi32(half, v), right);
+    __m256i localY = _mm256_blendv_epi8(_mm256_sub_epi32(half, u), u, right);
+    __m256i quadrant = _mm256_xor_si256(_mm256_srli_epi32(y, 15), _mm256_and_si256(right, _mm256_set1_epi32(3)));
+    return _mm256_or_si256(_mm256_slli_epi32(quadrant, 30), hilbertKey8(localY, localX));
+}
+
+TSM_TARGET("avx2") inline __m256i gridCell8(__m256 values, __m256 min, __m256 scale) {
+    __m256i cell = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_sub_ps(values, min), scale));
+    cell = _mm256_max_epi32(cell, _mm256_setzero_si256());
+    return _mm256_min_epi32(cell, _mm256_set1_epi32(static_cast<int>(gridMask)));
+}
+
+TSM_TARGET("avx2") void curveKeysAvx2(const float* xs, const float* ys, std::size_t count, const Grid& grid,
+                                      CurveType curve, PointId firstId, std::uint64_t* keys) {
+    const __m256 minX = _mm256_set1_ps(grid.minX);
+    const __m256 minY = _mm256_set1_ps(grid.minY);
+    const __m256 scale = _mm256_set1_ps(grid.scale);
+    const __m256i lane = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    const bool moore = curve == CurveType::Moore;
+
+    std::size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        __m256i x = gridCell8(_mm256_loadu_ps(xs + i), minX, scale);
+        __m256i y = gridCell8(_mm256_loadu_ps(ys + i), minY, scale);
+        __m256i key = moore ? mooreKey8(x, y) : hilbertKey8(x, y);
+        __m256i id = _mm256_add_epi32(_mm256_set1_epi32(static_cast<int>(firstId + i)), lane);
+        // Pair ids and keys into 64-bit lanes, which unpack does within 128-bit halves
+        __m256i low = _mm256_unpacklo_epi32(id, key);
+        __m256i high = _mm256_unpackhi_epi32(id, key);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i), _mm256_permute2x128_si256(low, high, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(keys + i + 4), _mm256_permute2x128_si256(low, high, 0x31));
+    }
+    _mm256_zeroupper();
+    curveKeysScalar(xs + i, ys + i, count - i, grid, curve, firstId + static_cast<PointId>(i), keys + i);
+}
+
+#endif // TSM_X86_DISPATCH
+
+CurveKernel selectCurveKernel() {
+#if TSM_X86_DISPATCH
+    if (detectSimdLevel() >= SimdLevel::AVX2) {
+        return curveKeysAvx2;
+    }
+#endif
+    return curveKeysScalar;
+}
+
+Grid fitGrid(const PointStore& cities) {
+    struct Bounds {
+        float minX, minY, maxX, maxY;
+    };
+    const float inf = std::numeric_limits<float>::infinity();
+    const float* xs = cities.xData();
+    const float* ys = cities.yData();
+    Bounds bounds = ThreadPool::shared().parallelReduce(
+        cities.size(), 1 << 16, Bounds{inf, inf, -inf, -inf},
+        [&](std::size_t begin, std::size_t end) {
+            Bounds local{inf, inf, -inf, -inf};
+            for (std::size_t i = begin; i < end; ++i) {
+                local.minX = std::min(local.minX, xs[i]);
+                local.minY = std::min(local.minY, ys[i]);
+                local.maxX = std::max(local.maxX, xs[i]);
+                local.maxY = std::max(local.maxY, ys[i]);
+            }
+            return local;
+        },
+        [](const Bounds& a, const Bounds& b) {
+            return Bounds{std::min(a.minX, b.minX), std::min(a.minY, b.minY), std::max(a.maxX, b.maxX),
+                          std::max(a.maxY, b.maxY)};
+        });
+
+    // Square cells keep the curve's locality the same along both axes
+    float extent = std::max(bounds.maxX - bounds.minX, bounds.maxY - bounds.minY);
+    float scale = extent > 0.0f ? static_cast<float>(gridMask) / extent : 0.0f;
+    return Grid{bounds.minX, bounds.minY, scale};
+}
+
+} // namespace
+
+Tour buildCurveTour(const PointStore& cities, CurveType curve) {
+    TSM_TRACE_SCOPE("buildCurveTour");
+    const std::size_t count = cities.size();
+    if (count == 0) {
+        return Tour();
+    }
+
+    static const CurveKernel kernel = selectCurveKernel();
+    const Grid grid = fitGrid(cities);
+    ThreadPool& pool = ThreadPool::shared();
+
+    // Key in the high half, city in the low one, so sorting by the high half alone
+    // orders the cities and keeps equal keys in ID order
+    std::vector<std::uint64_t> keys(count);
+    pool.parallelFor(count, 1 << 14, [&](std::size_t begin, std::size_t end) {
+        kernel(cities.xData() + begin, cities.yData() + begin, end - begin, grid, curve,
+               static_cast<PointId>(begin), keys.data() + begin);
+    });
+    radixSort(keys, 32, 64);
+
+    Tour tour(count);
+    pool.parallelFor(count, 1 << 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            tour[i] = static_cast<PointId>(keys[i]);
+        }
+    });
+    return tour;
+}
+
+void appendAlongCurve(const PointStore& cities, Tour& tour) {
+    if (tour.size() == cities.size()) {
+        return;
+    }
+    std::vector<bool> visited(cities.size(), false);
+    for (PointId city : tour) {
+        visited[city] = true;
+    }
+    for (PointId city : buildCurveTour(cities)) {
+        if (!visited[city]) {
+            tour.push_back(city);
+        }
+    }
+}
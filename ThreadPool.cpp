@@ -0,0 +1,148 @@
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <cstdlib>
+#include <string>
+
+namespace {
+
+// Pool and queue the current thread works for, if it is a pool worker
+thread_local const ThreadPool* currentPool = nullptr;
+thread_local std::size_t currentQueue = 0;
+
+// Yields a waiting thread makes before it blocks
+constexpr int spinRounds = 64;
+
+} // namespace
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) {
+        threads = std::max(std::thread::hardware_concurrency(), 1u);
+    }
+
+    const std::size_t workerCount = threads - 1;
+    for (std::size_t i = 0; i <= workerCount; ++i) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    workers.reserve(workerCount);
+    for (std::size_t i = 0; i < workerCount; ++i) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    wakeUp.notify_all();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool([] {
+        const char* threads = std::getenv("TSM_THREADS");
+        return threads ? static_cast<unsigned>(std::strtoul(threads, nullptr, 10)) : 0u;
+    }());
+    return pool;
+}
+
+std::size_t ThreadPool::localQueue() const {
+    return currentPool == this ? currentQueue : queues.size() - 1;
+}
+
+void ThreadPool::push(std::size_t queue, const Task* tasks, std::size_t count) {
+    {
+        std::lock_guard<std::mutex> lock(queues[queue]->mutex);
+        queues[queue]->tasks.insert(queues[queue]->tasks.end(), tasks, tasks + count);
+    }
+    queued.fetch_add(count, std::memory_order_release);
+    {
+        // Pairs with the sleep check in workerLoop so no wake-up is lost
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_all();
+}
+
+bool ThreadPool::runOne(std::size_t queue) {
+    Task task;
+    bool found = false;
+    // Own work newest first, stolen work oldest first
+    for (std::size_t offset = 0; offset < queues.size() && !found; ++offset) {
+        Queue& victim = *queues[(queue + offset) % queues.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (victim.tasks.empty()) {
+            continue;
+        }
+        if (offset == 0) {
+            task = victim.tasks.back();
+            victim.tasks.pop_back();
+        } else {
+            task = victim.tasks.front();
+            victim.tasks.pop_front();
+        }
+        found = true;
+    }
+    if (!found) {
+        return false;
+    }
+
+    queued.fetch_sub(1, std::memory_order_relaxed);
+    TSM_TRACE_SCOPE("task");
+    task.run(task.job, task.chunk);
+    return true;
+}
+
+void ThreadPool::waitFor(const std::atomic<std::size_t>& pending, std::size_t queue) {
+    int idle = 0;
+    while (pending.load(std::memory_order_acquire) != 0) {
+        // Help out while there is work, the remaining chunks may be queued anywhere
+        if (runOne(queue)) {
+            idle = 0;
+            continue;
+        }
+        // The last chunks are running elsewhere. Spin briefly since they are often
+        // about to finish, then sleep until they do or new work shows up, instead of
+        // taking a core from the threads being waited for.
+        if (++idle < spinRounds) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [&] {
+            return pending.load(std::memory_order_acquire) == 0 || queued.load(std::memory_order_acquire) != 0;
+        });
+        idle = 0;
+    }
+}
+
+void ThreadPool::chunkDone(std::atomic<std::size_t>& pending) {
+    if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    // pending may be gone as soon as its waiter sees zero, only the pool is touched
+    // from here on. Taking the lock pairs with the waiter's check like in push.
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    wakeUp.notify_all();
+}
+
+void ThreadPool::workerLoop(std::size_t index) {
+    currentPool = this;
+    currentQueue = index;
+    std::string name = "worker " + std::to_string(index + 1);
+    setTraceThreadName(name.c_str());
+
+    while (true) {
+        if (runOne(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        wakeUp.wait(lock, [this] { return stopping || queued.load(std::memory_order_acquire) != 0; });
+        if (stopping) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,231 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// Work-stealing thread pool. Every worker owns a task deque: it takes its own work
+// from the back and steals from the front of the others when it runs dry. Threads
+// that wait for a parallel call run queued tasks themselves meanwhile, so parallel
+// calls can nest and the calling thread always counts as one more worker.
+class ThreadPool {
+public:
+    // threads counts the calling thread, 0 uses every hardware thread
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Pool shared by the whole core. Sized from the TSM_THREADS environment variable
+    // if set, the hardware thread count otherwise.
+    static ThreadPool& shared();
+
+    // Threads that run tasks, the calling thread included
+    unsigned size() const { return static_cast<unsigned>(workers.size()) + 1; }
+
+    // Run function(chunk, begin, end) for chunks equal parts of [0, count) and wait.
+    // The split depends only on count and chunks, not on which thread runs a chunk,
+    // so per-chunk results are deterministic.
+    template <typename Function>
+    void forEachChunk(std::size_t count, std::size_t chunks, Function&& function);
+
+    // Run function(begin, end) over [0, count) in ranges of at least grain and wait
+    template <typename Function>
+    void parallelFor(std::size_t count, std::size_t grain, Function&& function);
+
+    // combine(...(combine(identity, map(range 0)), ...), map(range k)) in range order
+    // over ranges of grain elements. The ranges do not depend on the thread count, so
+    // neither does the result, even for floating point sums.
+    template <typename T, typename Map, typename Combine>
+    T parallelReduce(std::size_t count, std::size_t grain, T identity, Map&& map, Combine&& combine);
+
+    // Sort [first, last): chunks are sorted in parallel, then merged pairwise with each
+    // merge split into independent parts along its merge path.
+    template <typename T, typename Compare>
+    void parallelSort(T* first, T* last, Compare compare);
+
+    template <typename T, typename Compare>
+    void parallelSort(std::vector<T>& values, Compare compare) {
+        parallelSort(values.data(), values.data() + values.size(), compare);
+    }
+
+private:
+    // A chunk of a parallel call. job points to the caller's frame, which outlives
+    // the task because the caller waits for all its chunks.
+    struct Task {
+        void (*run)(void* job, std::size_t chunk);
+        void* job;
+        std::size_t chunk;
+    };
+
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    // Queue of the calling thread: its own for workers, the shared one otherwise
+    std::size_t localQueue() const;
+    void push(std::size_t queue, const Task* tasks, std::size_t count);
+    bool runOne(std::size_t queue);
+    void waitFor(const std::atomic<std::size_t>& pending, std::size_t queue);
+    // Count a finished chunk off pending, waking blocked waiters after the last one
+    void chunkDone(std::atomic<std::size_t>& pending);
+    void workerLoop(std::size_t index);
+
+    std::vector<std::thread> workers;
+    // One per worker plus the shared queue for outside threads, which is last
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::atomic<std::size_t> queued{0};
+    std::mutex sleepMutex;
+    std::condition_variable wakeUp;
+    bool stopping = false;
+};
+
+template <typename Function>
+void ThreadPool::forEachChunk(std::size_t count, std::size_t chunks, Function&& function) {
+    chunks = std::min(chunks, count);
+    if (chunks <= 1 || workers.empty()) {
+        for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+            function(chunk, count * chunk / chunks, count * (chunk + 1) / chunks);
+        }
+        return;
+    }
+
+    struct Job {
+        ThreadPool* pool;
+        Function* function;
+        std::size_t count;
+        std::size_t chunks;
+        std::atomic<std::size_t> pending;
+    } job{this, &function, count, chunks, {chunks}};
+
+    auto run = [](void* opaque, std::size_t chunk) {
+        Job& job = *static_cast<Job*>(opaque);
+        (*job.function)(chunk, job.count * chunk / job.chunks, job.count * (chunk + 1) / job.chunks);
+        job.pool->chunkDone(job.pending);
+    };
+
+    std::vector<Task> tasks(chunks);
+    for (std::size_t chunk = 0; chunk < chunks; ++chunk) {
+        tasks[chunk] = {run, &job, chunk};
+    }
+    const std::size_t queue = localQueue();
+    push(queue, tasks.data(), tasks.size());
+    waitFor(job.pending, queue);
+}
+
+template <typename Function>
+void ThreadPool::parallelFor(std::size_t count, std::size_t grain, Function&& function) {
+    grain = std::max<std::size_t>(grain, 1);
+    // A few chunks per thread let the stealing even out uneven ranges
+    std::size_t chunks = std::min((count + grain - 1) / grain, std::size_t{size()} * 4);
+    forEachChunk(count, chunks, [&function](std::size_t, std::size_t begin, std::size_t end) {
+        function(begin, end);
+    });
+}
+
+template <typename T, typename Map, typename Combine>
+T ThreadPool::parallelReduce(std::size_t count, std::size_t grain, T identity, Map&& map, Combine&& combine) {
+    grain = std::max<std::size_t>(grain, 1);
+    const std::size_t chunks = (count + grain - 1) / grain;
+    std::vector<T> partial(chunks, identity);
+    forEachChunk(count, chunks, [&](std::size_t chunk, std::size_t begin, std::size_t end) {
+        partial[chunk] = map(begin, end);
+    });
+
+    T result = identity;
+    for (const T& value : partial) {
+        result = combine(result, value);
+    }
+    return result;
+}
+
+template <typename T, typename Compare>
+void ThreadPool::parallelSort(T* first, T* last, Compare compare) {
+    const std::size_t count = static_cast<std::size_t>(last - first);
+    const std::size_t minChunk = 1 << 14;
+    std::size_t chunks = 1;
+    while (chunks < size() && count / (chunks * 2) >= minChunk) {
+        chunks *= 2;
+    }
+    if (chunks == 1) {
+        std::sort(first, last, compare);
+        return;
+    }
+
+    forEachChunk(count, chunks, [&](std::size_t, std::size_t begin, std::size_t end) {
+        std::sort(first + begin, first + end, compare);
+    });
+
+    // One part of merging the sorted runs a and b into out
+    struct Part {
+        T* a;
+        std::size_t aSize;
+        T* b;
+        std::size_t bSize;
+        T* out;
+        std::size_t begin;
+        std::size_t end;
+    };
+    // Elements of a among the first d merged ones, ties going to a like std::merge
+    auto coRank = [&compare](const T* a, std::size_t aSize, const T* b, std::size_t bSize, std::size_t d) {
+        std::size_t low = d > bSize ? d - bSize : 0;
+        std::size_t high = std::min(d, aSize);
+        while (low < high) {
+            std::size_t i = low + (high - low) / 2;
+            if (!compare(b[d - i - 1], a[i])) {
+                low = i + 1;
+            } else {
+                high = i;
+            }
+        }
+        return low;
+    };
+
+    std::vector<T> buffer(count);
+    T* source = first;
+    T* target = buffer.data();
+    std::vector<Part> parts;
+    for (std::size_t width = 1; width < chunks; width *= 2) {
+        // Every merge of this round, each cut into pieces of about minChunk outputs
+        parts.clear();
+        for (std::size_t chunk = 0; chunk < chunks; chunk += 2 * width) {
+            std::size_t begin = count * chunk / chunks;
+            std::size_t middle = count * std::min(chunk + width, chunks) / chunks;
+            std::size_t end = count * std::min(chunk + 2 * width, chunks) / chunks;
+            std::size_t pieces = std::max<std::size_t>(1, (end - begin) / minChunk);
+            pieces = std::min<std::size_t>(pieces, size());
+            for (std::size_t piece = 0; piece < pieces; ++piece) {
+                parts.push_back({source + begin, middle - begin, source + middle, end - middle, target + begin,
+                                 (end - begin) * piece / pieces, (end - begin) * (piece + 1) / pieces});
+            }
+        }
+        forEachChunk(parts.size(), parts.size(), [&](std::size_t index, std::size_t, std::size_t) {
+            const Part& part = parts[index];
+            std::size_t aBegin = coRank(part.a, part.aSize, part.b, part.bSize, part.begin);
+            std::size_t aEnd = coRank(part.a, part.aSize, part.b, part.bSize, part.end);
+            std::merge(std::make_move_iterator(part.a + aBegin), std::make_move_iterator(part.a + aEnd),
+                       std::make_move_iterator(part.b + (part.begin - aBegin)),
+                       std::make_move_iterator(part.b + (part.end - aEnd)), part.out + part.begin, compare);
+        });
+        std::swap(source, target);
+    }
+
+    if (source != first) {
+        parallelFor(count, minChunk, [&](std::size_t begin, std::size_t end) {
+            std::move(source + begin, source + end, first + begin);
+        });
+    }
+}
+
+#endif // THREADPOOL_H
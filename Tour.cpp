@@ -0,0 +1,109 @@
+#include "Tour.h"
+#include "DistanceKernels.h"
+#include "Net.h"
+#include "ThreadPool.h"
+#include "Trace.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+float calculateDistance(const Vector<2>& point1, const Vector<2>& point2) {
+    return distance(point1, point2);
+}
+
+std::size_t findClosestPoint(const Vector<2>& source, const PointStore& targets) {
+    float bestSquaredDistance;
+    std::size_t closest = getDistanceKernels().nearest(source[0], source[1], targets.xData(), targets.yData(),
+                                                       targets.size(), bestSquaredDistance);
+    if (closest == targets.size() || bestSquaredDistance > 0.0f) {
+        return closest;
+    }
+
+    // The closest target coincides with source, rescan skipping the source point itself
+    std::size_t closestPoint = targets.size();
+    float minSquaredDistance = std::numeric_limits<float>::max();
+
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        Vector<2> target = targets.get(i);
+        if (source == target) continue; // Skip the source point itself
+        float candidate = squaredDistance(source, target);
+        if (candidate < minSquaredDistance) {
+            minSquaredDistance = candidate;
+            closestPoint = i;
+        }
+    }
+
+    return closestPoint;
+}
+
+Tour buildPolarTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex) {
+    return sortByAngle(cities, net, netIndex.nearestAll(cities));
+}
+
+Tour buildPolarTour(const PointStore& cities, const PointStore& net) {
+    return buildPolarTour(cities, net, RingNetIndex(net));
+}
+
+Tour sortByAngle(const PointStore& cities, const PointStore& net, const std::vector<PointId>& closestNetPoints) {
+    TSM_TRACE_SCOPE("sort");
+    // Store the angle bucket and radius of each city's projection for sorting
+    struct PolarPoint {
+        PointId city;
+        int32_t sector;
+        float radius;
+    };
+    std::vector<PolarPoint> polarPoints(cities.size());
+    ThreadPool& pool = ThreadPool::shared();
+
+    Vector<2> center = calculateCenter(cities);
+
+    pool.parallelFor(cities.size(), 4096, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            std::size_t closest = closestNetPoints[i];
+            Vector<2> closestNetPoint = closest < net.size() ? net.get(closest) : cities.get(i);
+            float dx = closestNetPoint[0] - center[0];
+            float dy = closestNetPoint[1] - center[1];
+            // Angles within the same 0.001 rad sector count as equal and go by radius
+            int32_t sector = static_cast<int32_t>(std::floor(std::atan2(dy, dx) / 0.001f));
+            float radius = std::sqrt(dx * dx + dy * dy);
+            polarPoints[i] = {static_cast<PointId>(i), sector, radius};
+        }
+    });
+
+    // Sort the points by sector, then by radius and city so the order is total and
+    // the result does not depend on how the parallel sort splits the input
+    pool.parallelSort(polarPoints, [](const PolarPoint& a, const PolarPoint& b) {
+        if (a.sector != b.sector) {
+            return a.sector < b.sector;
+        }
+        if (a.radius != b.radius) {
+            return a.radius < b.radius;
+        }
+        return a.city < b.city;
+    });
+
+    Tour tour(polarPoints.size());
+    pool.parallelFor(polarPoints.size(), 1 << 16, [&](std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+            tour[i] = polarPoints[i].city;
+        }
+    });
+    return tour;
+}
+
+double tourLength(const PointStore& cities, const Tour& tour) {
+    if (tour.size() < 2) {
+        return 0.0;
+    }
+
+    double length = 0.0;
+    for (std::size_t i = 0; i < tour.size(); ++i) {
+        std::size_t from = tour[i];
+        std::size_t to = tour[(i + 1) % tour.size()];
+        float dx = cities.x(from) - cities.x(to);
+        float dy = cities.y(from) - cities.y(to);
+        length += std::sqrt(dx * dx + dy * dy);
+    }
+    return length;
+}
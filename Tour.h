@@ -0,0 +1,34 @@
+#ifndef TOUR_H
+#define TOUR_H
+
+#include "PointStore.h"
+#include "RingNetIndex.h"
+#include "Vector.h"
+#include <cstddef>
+#include <vector>
+
+// A tour is the visiting order of the cities, given as IDs into the city list.
+// The last city connects back to the first.
+using Tour = std::vector<PointId>;
+
+float calculateDistance(const Vector<2>& point1, const Vector<2>& point2);
+
+// Index of the target closest to source, skipping a target equal to source itself.
+// Returns targets.size() if there is no candidate. Linear scan, use a KdTree or
+// RingNetIndex for repeated queries against the same targets.
+std::size_t findClosestPoint(const Vector<2>& source, const PointStore& targets);
+
+// Project every city onto its closest net point and visit them in order of the
+// projection's angle around the city centroid, inner rings first on equal angles.
+// netIndex must be built over net.
+Tour buildPolarTour(const PointStore& cities, const PointStore& net, const RingNetIndex& netIndex);
+Tour buildPolarTour(const PointStore& cities, const PointStore& net);
+
+// The sorting half of buildPolarTour: closestNetPoints[i] is the net point city i
+// projects onto, or net.size() to use the city itself.
+Tour sortByAngle(const PointStore& cities, const PointStore& net, const std::vector<PointId>& closestNetPoints);
+
+// Closed length of the tour, including the edge from the last city back to the first.
+double tourLength(const PointStore& cities, const Tour& tour);
+
+#endif // TOUR_H
@@ -0,0 +1,113 @@
+#include "Trace.h"
+#include <chrono>
+#include <cstdio>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+    const char* name;
+    std::int64_t start;
+    std::int64_t end;
+};
+
+// One track. Owned by the registry as well so it outlives its thread.
+struct ThreadTrace {
+    std::uint32_t id;
+    std::string name;
+    std::vector<TraceEvent> events;
+};
+
+struct Registry {
+    std::mutex mutex;
+    std::vector<std::shared_ptr<ThreadTrace>> threads;
+};
+
+Registry& registry() {
+    static Registry instance;
+    return instance;
+}
+
+ThreadTrace& localTrace() {
+    thread_local std::shared_ptr<ThreadTrace> trace = [] {
+        Registry& all = registry();
+        std::lock_guard<std::mutex> lock(all.mutex);
+        auto created = std::make_shared<ThreadTrace>();
+        created->id = static_cast<std::uint32_t>(all.threads.size());
+        created->name = "thread " + std::to_string(created->id);
+        all.threads.push_back(created);
+        return created;
+    }();
+    return *trace;
+}
+
+void writeEscaped(std::FILE* file, const char* text) {
+    for (const char* c = text; *c != '\0'; ++c) {
+        if (*c == '"' || *c == '\\') {
+            std::fputc('\\', file);
+        }
+        std::fputc(*c, file);
+    }
+}
+
+} // namespace
+
+std::int64_t traceClockNs() {
+    static const auto epoch = std::chrono::steady_clock::now();
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - epoch).count();
+}
+
+void recordTraceEvent(const char* name, std::int64_t startNs, std::int64_t endNs) {
+    localTrace().events.push_back({name, startNs, endNs});
+}
+
+void setTraceThreadName(const char* name) {
+    localTrace().name = name;
+}
+
+bool writeChromeTrace(const char* path) {
+    std::FILE* file = std::fopen(path, "w");
+    if (!file) {
+        std::cerr << "Failed to write trace " << path << std::endl;
+        return false;
+    }
+
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    std::fprintf(file, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [");
+    bool first = true;
+    for (const auto& thread : all.threads) {
+        std::fprintf(file, "%s\n{\"ph\": \"M\", \"name\": \"thread_name\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": \"",
+                     first ? "" : ",", thread->id);
+        writeEscaped(file, thread->name.c_str());
+        std::fprintf(file, "\"}}");
+        first = false;
+
+        // Complete events, timestamps in microseconds
+        for (const TraceEvent& event : thread->events) {
+            std::fprintf(file, ",\n{\"ph\": \"X\", \"name\": \"");
+            writeEscaped(file, event.name);
+            std::fprintf(file, "\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", thread->id,
+                         event.start / 1000.0, (event.end - event.start) / 1000.0);
+        }
+    }
+    std::fprintf(file, "\n]}\n");
+
+    bool written = std::fclose(file) == 0;
+    if (!written) {
+        std::cerr << "Failed to write trace " << path << std::endl;
+    }
+    return written;
+}
+
+void clearTrace() {
+    Registry& all = registry();
+    std::lock_guard<std::mutex> lock(all.mutex);
+    for (const auto& thread : all.threads) {
+        thread->events.clear();
+    }
+}
@@ -0,0 +1,52 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+
+// Scoped phase timers exported as Chrome trace JSON, viewable in chrome://tracing or
+// ui.perfetto.dev. Recording is only compiled in with TSM_TRACING defined (CMake
+// option TSM_TRACING). Without it TSM_TRACE_SCOPE expands to nothing and the phases
+// cost nothing. Every thread records into its own buffer and gets its own track.
+
+// Nanoseconds on the trace clock, which starts with the first trace call
+std::int64_t traceClockNs();
+
+// Record a finished phase on the calling thread's track. name must stay valid until
+// the trace is written, string literals are what TSM_TRACE_SCOPE passes.
+void recordTraceEvent(const char* name, std::int64_t startNs, std::int64_t endNs);
+
+// Name the calling thread's track, "thread N" otherwise
+void setTraceThreadName(const char* name);
+
+// Write everything recorded so far. Other threads must not be recording meanwhile.
+// Returns false and reports to std::cerr if the file cannot be written.
+bool writeChromeTrace(const char* path);
+
+// Drop everything recorded so far
+void clearTrace();
+
+// Records the time between its construction and destruction
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name) : name(name), start(traceClockNs()) {}
+    ~ScopedTimer() { recordTraceEvent(name, start, traceClockNs()); }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    std::int64_t start;
+};
+
+#define TSM_TRACE_CONCAT_INNER(a, b) a##b
+#define TSM_TRACE_CONCAT(a, b) TSM_TRACE_CONCAT_INNER(a, b)
+
+#ifdef TSM_TRACING
+// Time the rest of the enclosing scope as phase name
+#define TSM_TRACE_SCOPE(name) ScopedTimer TSM_TRACE_CONCAT(traceScope, __LINE__)(name)
+#else
+#define TSM_TRACE_SCOPE(name) ((void)0)
+#endif
+
+#endif // TRACE_H
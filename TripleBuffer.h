@@ -0,0 +1,46 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <atomic>
+
+// Lock-free hand-off of the latest value from one writer thread to one reader thread.
+// The writer fills its back slot and swaps it with the middle one, the reader swaps the
+// middle slot with its front one when it holds something new. Each side does a single
+// atomic exchange, so neither ever waits for the other; values the reader did not get
+// to in time are skipped. Slots are reused, so their allocations are too.
+template <typename T>
+class TripleBuffer {
+public:
+    // Writer: the slot to fill next, invisible to the reader until publish()
+    T& back() { return slots[backIndex]; }
+
+    // Writer: make the back slot the newest value
+    void publish() {
+        backIndex = middle.exchange(backIndex | FRESH, std::memory_order_acq_rel) & INDEX;
+    }
+
+    // Reader: adopt the newest published value. Returns true if front() changed.
+    bool update() {
+        if ((middle.load(std::memory_order_relaxed) & FRESH) == 0) {
+            return false;
+        }
+        frontIndex = middle.exchange(frontIndex, std::memory_order_acq_rel) & INDEX;
+        return true;
+    }
+
+    // Reader: the value adopted by the last successful update()
+    const T& front() const { return slots[frontIndex]; }
+
+private:
+    static constexpr unsigned INDEX = 3;
+    // Set in middle while it holds a value the reader has not taken yet
+    static constexpr unsigned FRESH = 4;
+
+    T slots[3];
+    // Each index has its own cache line so the two threads do not share one
+    alignas(64) unsigned backIndex = 0;
+    alignas(64) std::atomic<unsigned> middle{1};
+    alignas(64) unsigned frontIndex = 2;
+};
+
+#endif // TRIPLEBUFFER_H
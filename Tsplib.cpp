@@ -0,0 +1,437 @@
+#include "Tsplib.h"
+#include "MappedFile.h"
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <vector>
+
+namespace {
+
+// Read position in a mapped file. Everything below parses in place and never allocates.
+struct Cursor {
+    const char* p;
+    const char* end;
+};
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool isDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+void skipBlanks(Cursor& cursor) {
+    while (cursor.p < cursor.end && isBlank(*cursor.p)) {
+        ++cursor.p;
+    }
+}
+
+void skipWhitespace(Cursor& cursor) {
+    while (cursor.p < cursor.end && (isBlank(*cursor.p) || *cursor.p == '\n')) {
+        ++cursor.p;
+    }
+}
+
+void skipLine(Cursor& cursor) {
+    if (cursor.p >= cursor.end) {
+        return;
+    }
+    const void* newline = std::memchr(cursor.p, '\n', static_cast<std::size_t>(cursor.end - cursor.p));
+    cursor.p = newline ? static_cast<const char*>(newline) + 1 : cursor.end;
+}
+
+// Keyword at the cursor, up to a blank, colon or line end
+struct Token {
+    const char* begin;
+    std::size_t length;
+
+    bool is(const char* keyword) const {
+        return std::strlen(keyword) == length && std::memcmp(begin, keyword, length) == 0;
+    }
+};
+
+Token readKeyword(Cursor& cursor) {
+    const char* begin = cursor.p;
+    while (cursor.p < cursor.end && !isBlank(*cursor.p) && *cursor.p != ':' && *cursor.p != '\n') {
+        ++cursor.p;
+    }
+    return {begin, static_cast<std::size_t>(cursor.p - begin)};
+}
+
+// Value after "KEYWORD :" up to the line end, trailing blanks removed
+Token readValue(Cursor& cursor) {
+    skipBlanks(cursor);
+    if (cursor.p < cursor.end && *cursor.p == ':') {
+        ++cursor.p;
+        skipBlanks(cursor);
+    }
+    const char* begin = cursor.p;
+    skipLine(cursor);
+    const char* last = cursor.p;
+    while (last > begin && (isBlank(last[-1]) || last[-1] == '\n')) {
+        --last;
+    }
+    return {begin, static_cast<std::size_t>(last - begin)};
+}
+
+// Exact powers of ten, larger exponents fall back to std::pow
+constexpr double POWERS_OF_TEN[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+double powerOfTen(int exponent) {
+    int magnitude = exponent < 0 ? -exponent : exponent;
+    double power = magnitude <= 22 ? POWERS_OF_TEN[magnitude] : std::pow(10.0, magnitude);
+    return exponent < 0 ? 1.0 / power : power;
+}
+
+// Decimal number with optional sign, fraction and exponent, after any whitespace
+bool parseNumber(Cursor& cursor, double& value) {
+    skipWhitespace(cursor);
+    const char* p = cursor.p;
+    const char* end = cursor.end;
+
+    bool negative = false;
+    if (p < end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+
+    // Up to 19 significant digits fit into the mantissa, the rest only shift the exponent
+    std::uint64_t mantissa = 0;
+    int significant = 0;
+    int exponent = 0;
+    bool anyDigit = false;
+    for (; p < end && isDigit(*p); ++p) {
+        anyDigit = true;
+        if (significant < 19) {
+            mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+            significant += mantissa != 0;
+        } else {
+            ++exponent;
+        }
+    }
+    if (p < end && *p == '.') {
+        for (++p; p < end && isDigit(*p); ++p) {
+            anyDigit = true;
+            if (significant < 19) {
+                mantissa = mantissa * 10 + static_cast<std::uint64_t>(*p - '0');
+                significant += mantissa != 0;
+                --exponent;
+            }
+        }
+    }
+    if (!anyDigit) {
+        return false;
+    }
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        const char* q = p + 1;
+        bool negativeExponent = false;
+        if (q < end && (*q == '-' || *q == '+')) {
+            negativeExponent = *q == '-';
+            ++q;
+        }
+        if (q < end && isDigit(*q)) {
+            int written = 0;
+            for (; q < end && isDigit(*q); ++q) {
+                if (written < 10000) {
+                    written = written * 10 + (*q - '0');
+                }
+            }
+            exponent += negativeExponent ? -written : written;
+            p = q;
+        }
+    }
+
+    double magnitude = static_cast<double>(mantissa);
+    if (exponent != 0 && mantissa != 0) {
+        // Dividing by an exact power keeps the usual one-decimal coordinates exact
+        magnitude = exponent < 0 && exponent >= -22 ? magnitude / POWERS_OF_TEN[-exponent]
+                                                     : magnitude * powerOfTen(exponent);
+    }
+    value = negative ? -magnitude : magnitude;
+    cursor.p = p;
+    return true;
+}
+
+bool parseInteger(Cursor& cursor, long long& value) {
+    skipWhitespace(cursor);
+    const char* p = cursor.p;
+    bool negative = false;
+    if (p < cursor.end && (*p == '-' || *p == '+')) {
+        negative = *p == '-';
+        ++p;
+    }
+    if (p == cursor.end || !isDigit(*p)) {
+        return false;
+    }
+    long long magnitude = 0;
+    for (; p < cursor.end && isDigit(*p); ++p) {
+        const int digit = *p - '0';
+        if (magnitude > (std::numeric_limits<long long>::max() - digit) / 10) {
+            return false;
+        }
+        magnitude = magnitude * 10 + digit;
+    }
+    value = negative ? -magnitude : magnitude;
+    cursor.p = p;
+    return true;
+}
+
+// Largest coordinate magnitude accepted, far beyond any TSPLIB instance. It fits into a
+// float and keeps every distance, and the length of any tour of up to 10^9 cities,
+// within long long. Infinite and NaN coordinates are rejected too.
+constexpr double MAX_COORDINATE = 1e9;
+
+bool isCoordinate(double value) {
+    return std::fabs(value) <= MAX_COORDINATE;
+}
+
+bool parseInteger(const Token& token, long long& value) {
+    Cursor cursor{token.begin, token.begin + token.length};
+    return parseInteger(cursor, value) && cursor.p == cursor.end;
+}
+
+bool parseEdgeWeightType(const Token& token, EdgeWeightType& type) {
+    if (token.is("EUC_2D")) {
+        type = EdgeWeightType::Euc2D;
+    } else if (token.is("CEIL_2D")) {
+        type = EdgeWeightType::Ceil2D;
+    } else if (token.is("GEO")) {
+        type = EdgeWeightType::Geo;
+    } else if (token.is("ATT")) {
+        type = EdgeWeightType::Att;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+// Latitude or longitude in radians from TSPLIB's DDD.MM notation
+double geoRadians(double coordinate) {
+    const double pi = 3.141592;
+    double degrees = static_cast<double>(static_cast<long long>(coordinate));
+    double minutes = coordinate - degrees;
+    return pi * (degrees + 5.0 * minutes / 3.0) / 180.0;
+}
+
+} // namespace
+
+const char* edgeWeightTypeName(EdgeWeightType type) {
+    switch (type) {
+        case EdgeWeightType::Ceil2D: return "CEIL_2D";
+        case EdgeWeightType::Geo: return "GEO";
+        case EdgeWeightType::Att: return "ATT";
+        default: return "EUC_2D";
+    }
+}
+
+bool loadTsplib(const char* path, TsplibInstance& instance) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    instance.name.clear();
+    instance.edgeWeightType = EdgeWeightType::Euc2D;
+    instance.cities.clear();
+    instance.xs.clear();
+    instance.ys.clear();
+
+    Cursor cursor{file.begin(), file.end()};
+    long long dimension = -1;
+    bool edgeWeightTypeSeen = false;
+    while (true) {
+        skipWhitespace(cursor);
+        if (cursor.p == cursor.end) {
+            std::cerr << path << ": no NODE_COORD_SECTION" << std::endl;
+            return false;
+        }
+        Token keyword = readKeyword(cursor);
+        if (keyword.is("NODE_COORD_SECTION")) {
+            skipLine(cursor);
+            break;
+        }
+        if (keyword.is("EOF")) {
+            std::cerr << path << ": no NODE_COORD_SECTION" << std::endl;
+            return false;
+        }
+
+        Token value = readValue(cursor);
+        if (keyword.is("NAME")) {
+            instance.name.assign(value.begin, value.length);
+        } else if (keyword.is("TYPE")) {
+            if (!value.is("TSP")) {
+                std::cerr << path << ": unsupported TYPE " << std::string(value.begin, value.length) << std::endl;
+                return false;
+            }
+        } else if (keyword.is("DIMENSION")) {
+            if (!parseInteger(value, dimension) || dimension < 0) {
+                std::cerr << path << ": malformed DIMENSION" << std::endl;
+                return false;
+            }
+        } else if (keyword.is("EDGE_WEIGHT_TYPE")) {
+            if (!parseEdgeWeightType(value, instance.edgeWeightType)) {
+                std::cerr << path << ": unsupported EDGE_WEIGHT_TYPE "
+                          << std::string(value.begin, value.length) << std::endl;
+                return false;
+            }
+            edgeWeightTypeSeen = true;
+        }
+    }
+
+    if (dimension < 0) {
+        std::cerr << path << ": DIMENSION missing before NODE_COORD_SECTION" << std::endl;
+        return false;
+    }
+    if (!edgeWeightTypeSeen) {
+        std::cerr << path << ": EDGE_WEIGHT_TYPE missing before NODE_COORD_SECTION" << std::endl;
+        return false;
+    }
+
+    // Every node line needs at least "1 0 0" and a separator, so a DIMENSION the rest
+    // of the file cannot hold is rejected before anything is allocated for it
+    const std::size_t remaining = static_cast<std::size_t>(cursor.end - cursor.p);
+    if (static_cast<unsigned long long>(dimension) > std::numeric_limits<PointId>::max() ||
+        static_cast<std::size_t>(dimension) > (remaining + 1) / 6) {
+        std::cerr << path << ": DIMENSION " << dimension << " is more than the file holds" << std::endl;
+        return false;
+    }
+
+    const std::size_t count = static_cast<std::size_t>(dimension);
+    instance.cities.reserve(count);
+    instance.xs.reserve(count);
+    instance.ys.reserve(count);
+    std::vector<char> seen(count, 0);
+    for (std::size_t i = 0; i < count; ++i) {
+        long long node;
+        double x;
+        double y;
+        if (!parseInteger(cursor, node) || !parseNumber(cursor, x) || !parseNumber(cursor, y) ||
+            !isCoordinate(x) || !isCoordinate(y)) {
+            std::cerr << path << ": malformed coordinate line " << i + 1 << " of NODE_COORD_SECTION" << std::endl;
+            return false;
+        }
+        if (node < 1 || node > dimension || seen[node - 1]) {
+            std::cerr << path << ": invalid or repeated node " << node << std::endl;
+            return false;
+        }
+        seen[node - 1] = 1;
+        instance.cities.add(static_cast<float>(x), static_cast<float>(y), static_cast<PointId>(node - 1));
+        instance.xs.push_back(x);
+        instance.ys.push_back(y);
+    }
+
+    return true;
+}
+
+bool loadTsplibTour(const char* path, const TsplibInstance& instance, Tour& tour) {
+    MappedFile file;
+    if (!file.open(path)) {
+        return false;
+    }
+
+    Cursor cursor{file.begin(), file.end()};
+    long long dimension = -1;
+    while (true) {
+        skipWhitespace(cursor);
+        if (cursor.p == cursor.end) {
+            std::cerr << path << ": no TOUR_SECTION" << std::endl;
+            return false;
+        }
+        Token keyword = readKeyword(cursor);
+        if (keyword.is("TOUR_SECTION")) {
+            skipLine(cursor);
+            break;
+        }
+        Token value = readValue(cursor);
+        if (keyword.is("TYPE") && !value.is("TOUR")) {
+            std::cerr << path << ": unsupported TYPE " << std::string(value.begin, value.length) << std::endl;
+            return false;
+        }
+        if (keyword.is("DIMENSION") && !parseInteger(value, dimension)) {
+            std::cerr << path << ": malformed DIMENSION" << std::endl;
+            return false;
+        }
+    }
+
+    const std::size_t count = instance.cities.size();
+    if (dimension >= 0 && static_cast<std::size_t>(dimension) != count) {
+        std::cerr << path << ": tour DIMENSION " << dimension << " does not match the " << count
+                  << " cities of the instance" << std::endl;
+        return false;
+    }
+
+    // Node ids are usually the indices already, only build a map if they are not
+    std::vector<PointId> indexOfNode;
+    for (std::size_t i = 0; i < count; ++i) {
+        if (instance.cities.id(i) != i) {
+            indexOfNode.assign(count, 0);
+            for (std::size_t j = 0; j < count; ++j) {
+                indexOfNode[instance.cities.id(j)] = static_cast<PointId>(j);
+            }
+            break;
+        }
+    }
+
+    tour.clear();
+    tour.reserve(count);
+    std::vector<char> seen(count, 0);
+    long long node;
+    while (parseInteger(cursor, node) && node != -1) {
+        if (node < 1 || static_cast<std::size_t>(node) > count || seen[node - 1]) {
+            std::cerr << path << ": invalid or repeated node " << node << std::endl;
+            return false;
+        }
+        seen[node - 1] = 1;
+        PointId index = static_cast<PointId>(node - 1);
+        tour.push_back(indexOfNode.empty() ? index : indexOfNode[index]);
+    }
+
+    if (tour.size() != count) {
+        std::cerr << path << ": tour visits " << tour.size() << " of " << count << " cities" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+long long tsplibDistance(const TsplibInstance& instance, std::size_t a, std::size_t b) {
+    const std::vector<double>& xs = instance.xs;
+    const std::vector<double>& ys = instance.ys;
+    double dx = xs[a] - xs[b];
+    double dy = ys[a] - ys[b];
+
+    switch (instance.edgeWeightType) {
+        case EdgeWeightType::Ceil2D:
+            return static_cast<long long>(std::ceil(std::sqrt(dx * dx + dy * dy)));
+        case EdgeWeightType::Att: {
+            double r = std::sqrt((dx * dx + dy * dy) / 10.0);
+            long long t = static_cast<long long>(r + 0.5);
+            return t < r ? t + 1 : t;
+        }
+        case EdgeWeightType::Geo: {
+            const double earthRadius = 6378.388;
+            double latitudeA = geoRadians(xs[a]);
+            double longitudeA = geoRadians(ys[a]);
+            double latitudeB = geoRadians(xs[b]);
+            double longitudeB = geoRadians(ys[b]);
+            double q1 = std::cos(longitudeA - longitudeB);
+            double q2 = std::cos(latitudeA - latitudeB);
+            double q3 = std::cos(latitudeA + latitudeB);
+            return static_cast<long long>(
+                earthRadius * std::acos(0.5 * ((1.0 + q1) * q2 - (1.0 - q1) * q3)) + 1.0);
+        }
+        default:
+            return static_cast<long long>(std::sqrt(dx * dx + dy * dy) + 0.5);
+    }
+}
+
+long long tsplibTourLength(const TsplibInstance& instance, const Tour& tour) {
+    long long length = 0;
+    for (std::size_t i = 0; i < tour.size(); ++i) {
+        length += tsplibDistance(instance, tour[i], tour[(i + 1) % tour.size()]);
+    }
+    return length;
+}
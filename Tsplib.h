@@ -0,0 +1,52 @@
+#ifndef TSPLIB_H
+#define TSPLIB_H
+
+#include "PointStore.h"
+#include "Tour.h"
+#include <string>
+#include <vector>
+
+// Distance functions of the TSPLIB coordinate formats we read
+enum class EdgeWeightType {
+    // Euclidean distance rounded to the nearest integer
+    Euc2D,
+    // Euclidean distance rounded up
+    Ceil2D,
+    // Great circle distance, coordinates are DDD.MM latitude and longitude
+    Geo,
+    // Pseudo-Euclidean distance of the att48 / att532 instances
+    Att
+};
+
+struct TsplibInstance {
+    std::string name;
+    EdgeWeightType edgeWeightType = EdgeWeightType::Euc2D;
+    // Node i of the file (1-based) is stored with id i - 1. x is the first coordinate
+    // (latitude for GEO). Coordinates are kept as float like every other point store.
+    PointStore cities;
+    // The coordinates as written, in the order of cities, for tsplibDistance. Rounding
+    // them to float would shift large instances' lengths by a few units.
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+const char* edgeWeightTypeName(EdgeWeightType type);
+
+// Load a TSPLIB .tsp file with a NODE_COORD_SECTION. The file is memory-mapped and the
+// numbers are parsed in place straight into instance.cities and its exact coordinates.
+// Returns false and reports to std::cerr on malformed or unsupported files, which
+// includes a DIMENSION more than the file can hold and coordinates beyond +-10^9.
+bool loadTsplib(const char* path, TsplibInstance& instance);
+
+// Load a TSPLIB .tour file for instance. Node numbers are translated to indices into
+// instance.cities. Returns false and reports to std::cerr if the tour is not a
+// permutation of the instance's cities.
+bool loadTsplibTour(const char* path, const TsplibInstance& instance, Tour& tour);
+
+// Distance between cities a and b under the instance's edge weight type, as defined
+// by TSPLIB and from the exact coordinates, so tour lengths compare directly with
+// published optima.
+long long tsplibDistance(const TsplibInstance& instance, std::size_t a, std::size_t b);
+long long tsplibTourLength(const TsplibInstance& instance, const Tour& tour);
+
+#endif // TSPLIB_H
@@ -0,0 +1,89 @@
+// Regression check for the TSPLIB loader: a valid file loads with the expected
+// lengths, and malformed ones are rejected with a message instead of throwing,
+// overflowing or loading as garbage. Writes its inputs to the current directory.
+// Exits with 1 if any case fails.
+
+#include "Tsplib.h"
+#include <cstdio>
+#include <exception>
+#include <iostream>
+#include <string>
+
+namespace {
+
+const char* const PATH = "tsm_tsplib_check.tsp";
+const char* const TOUR_PATH = "tsm_tsplib_check.tour";
+
+bool writeFile(const char* path, const std::string& text) {
+    std::FILE* file = std::fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to write " << path << std::endl;
+        return false;
+    }
+    bool written = std::fwrite(text.data(), 1, text.size(), file) == text.size();
+    return std::fclose(file) == 0 && written;
+}
+
+std::string instanceText(const std::string& dimension, const std::string& coordinates) {
+    return "NAME : check\nTYPE : TSP\nDIMENSION : " + dimension + "\nEDGE_WEIGHT_TYPE : EUC_2D\n"
+           "NODE_COORD_SECTION\n" + coordinates + "EOF\n";
+}
+
+// Whether loadTsplib accepts text, false with a message if it throws
+bool loads(const std::string& text, TsplibInstance& instance) {
+    if (!writeFile(PATH, text)) {
+        return false;
+    }
+    try {
+        return loadTsplib(PATH, instance);
+    } catch (const std::exception& exception) {
+        std::cerr << "loadTsplib threw " << exception.what() << std::endl;
+        return false;
+    }
+}
+
+bool check(bool condition, const char* name) {
+    std::cout << (condition ? "ok   " : "FAIL ") << name << std::endl;
+    return condition;
+}
+
+} // namespace
+
+int main() {
+    bool passed = true;
+    const std::string square = "1 0 0\n2 3 0\n3 3 4\n4 0 4\n";
+
+    TsplibInstance instance;
+    bool valid = loads(instanceText("4", square), instance);
+    passed &= check(valid && instance.cities.size() == 4 && tsplibTourLength(instance, {0, 1, 2, 3}) == 14 &&
+                        tsplibTourLength(instance, {0, 2, 1, 3}) == 18,
+                    "valid instance and its tour lengths");
+
+    // 16777217 is the first integer a float cannot hold
+    TsplibInstance wide;
+    passed &= check(loads(instanceText("2", "1 0 0\n2 16777217 0.4\n"), wide) &&
+                        tsplibTourLength(wide, {0, 1}) == 2 * 16777217LL,
+                    "lengths from the exact coordinates");
+
+    TsplibInstance rejected;
+    passed &= check(!loads(instanceText("99999999999", square), rejected), "DIMENSION larger than the file");
+    passed &= check(!loads(instanceText("4294967296", square), rejected), "DIMENSION beyond PointId");
+    passed &= check(!loads(instanceText("99999999999999999999999", square), rejected), "DIMENSION overflowing");
+    passed &= check(!loads(instanceText("2", "1 0 0\n99999999999999999999999 1 1\n"), rejected),
+                    "node number overflowing");
+    passed &= check(!loads(instanceText("2", "1 0 0\n2 1e400 1\n"), rejected), "coordinate beyond double");
+    passed &= check(!loads(instanceText("2", "1 0 0\n2 1 -1e39\n"), rejected), "coordinate beyond float");
+    passed &= check(!loads(instanceText("2", "1 0 0\n2 1 1e30\n"), rejected), "coordinate too large");
+    passed &= check(!loads(instanceText("3", "1 0 0\n2 1 1\n"), rejected), "missing node line");
+
+    if (valid) {
+        Tour tour;
+        passed &= check(writeFile(TOUR_PATH, "TYPE : TOUR\nTOUR_SECTION\n1\n99999999999999999999999\n-1\n") &&
+                            !loadTsplibTour(TOUR_PATH, instance, tour),
+                        "tour node number overflowing");
+    }
+
+    std::remove(PATH);
+    std::remove(TOUR_PATH);
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,109 @@
+#include "TwoOpt.h"
+#include "Trace.h"
+#include <chrono>
+#include <deque>
+#include <vector>
+
+namespace {
+
+// Gains smaller than this are treated as rounding noise
+constexpr double MIN_GAIN = 1e-7;
+
+} // namespace
+
+ImprovementReport improveTwoOpt(const PointStore& cities, Tour& tour, const TwoOptOptions& options) {
+    NeighbourLists neighbours(cities, options.neighbours);
+    return improveTwoOpt(cities, tour, neighbours, options);
+}
+
+ImprovementReport improveTwoOpt(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                const TwoOptOptions& options) {
+    TSM_TRACE_SCOPE("twoOpt");
+    auto start = std::chrono::steady_clock::now();
+    auto elapsed = [&start] {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    };
+
+    ImprovementReport report;
+    report.initialLength = tourLength(cities, tour);
+    report.finalLength = report.initialLength;
+    const std::size_t n = tour.size();
+    if (n < 5) {
+        return report;
+    }
+
+    ArrayTour array(tour);
+    std::vector<char> queued(n, 1);
+    std::deque<std::size_t> queue(tour.begin(), tour.end());
+    auto activate = [&](std::size_t city) {
+        if (!queued[city]) {
+            queued[city] = 1;
+            queue.push_back(city);
+        }
+    };
+
+    double length = report.initialLength;
+    double lastProgress = 0.0;
+    std::size_t reportedMoves = 0;
+    std::size_t steps = 0;
+    while (!queue.empty()) {
+        if ((++steps & 255) == 0) {
+            const double seconds = elapsed();
+            if (seconds > options.timeLimitSeconds ||
+                (options.stop != nullptr && options.stop->load(std::memory_order_relaxed))) {
+                break;
+            }
+            if (options.progress && report.moves != reportedMoves && seconds - lastProgress >= options.progressSeconds) {
+                lastProgress = seconds;
+                reportedMoves = report.moves;
+                options.progress(array.getOrder(), length);
+            }
+        }
+        const std::size_t a = queue.front();
+        queue.pop_front();
+        queued[a] = 0;
+
+        bool improved = false;
+        for (int direction = 0; direction < 2 && !improved; ++direction) {
+            const bool forward = direction == 0;
+            const std::size_t b = forward ? array.next(a) : array.prev(a);
+            const double ab = cityDistance(cities, a, b);
+
+            for (const PointId* it = neighbours.begin(a); it != neighbours.end(a); ++it) {
+                const std::size_t c = *it;
+                const double ac = cityDistance(cities, a, c);
+                // Candidates are sorted, so no later one can shorten the tour either
+                if (ac >= ab) {
+                    break;
+                }
+                const std::size_t d = forward ? array.next(c) : array.prev(c);
+                if (c == b || d == a) {
+                    continue;
+                }
+
+                double gain = ab + cityDistance(cities, c, d) - ac - cityDistance(cities, b, d);
+                if (gain > MIN_GAIN) {
+                    // Replace edges (a, b) and (c, d) with (a, c) and (b, d)
+                    if (forward) {
+                        array.reverse(b, c);
+                    } else {
+                        array.reverse(a, d);
+                    }
+                    length -= gain;
+                    ++report.moves;
+                    activate(a);
+                    activate(b);
+                    activate(c);
+                    activate(d);
+                    improved = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    tour = array.getOrder();
+    report.finalLength = tourLength(cities, tour);
+    report.seconds = elapsed();
+    return report;
+}
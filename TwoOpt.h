@@ -0,0 +1,34 @@
+#ifndef TWOOPT_H
+#define TWOOPT_H
+
+#include "LocalSearch.h"
+#include "NeighbourLists.h"
+#include "PointStore.h"
+#include "Tour.h"
+#include <atomic>
+#include <cstddef>
+#include <limits>
+
+struct TwoOptOptions {
+    // Candidate neighbours per city
+    std::size_t neighbours = 8;
+    double timeLimitSeconds = std::numeric_limits<double>::infinity();
+    // Checked along with the time limit, the search stops early once it is set
+    const std::atomic<bool>* stop = nullptr;
+    // Called with the improved tour at most every progressSeconds while the search runs
+    ImprovementCallback progress;
+    double progressSeconds = 0.05;
+};
+
+// Improve the tour in place with 2-opt until no improving move is left or the time
+// limit is reached. Only moves that create an edge from a city to one of its
+// candidate neighbours are tried, and a city whose candidates gave nothing is not
+// looked at again until one of its tour edges changes (don't-look bits). Each sweep
+// is therefore close to linear instead of O(n^2). Works on a tour from any constructor.
+ImprovementReport improveTwoOpt(const PointStore& cities, Tour& tour, const TwoOptOptions& options = TwoOptOptions());
+
+// Same, reusing candidate lists that were already built over cities.
+ImprovementReport improveTwoOpt(const PointStore& cities, Tour& tour, const NeighbourLists& neighbours,
+                                const TwoOptOptions& options = TwoOptOptions());
+
+#endif // TWOOPT_H
@@ -2,25 +2,36 @@
 #define VECTOR_H
 
 #include <array>
+#include <cassert>
 #include <cmath>
-#include <functional> // Include this for std::hash
+#include <cstddef>
 #include <type_traits>
 
 // Enable if the number of arguments matches N and all are convertible to float
 template<std::size_t N, typename... T>
 using vector_t = std::enable_if_t<(sizeof...(T) == N) && std::conjunction_v<std::is_convertible<T, float>...>>;
 
+// Alignment of Vector<N>. Two and four floats are aligned to their full size so they
+// load into one SSE register, and the element loops below compile to single packed
+// instructions while staying constexpr.
 template<std::size_t N>
-class Vector {
-    std::array<float, N> elems;
+struct VectorAlignment : std::integral_constant<std::size_t, alignof(float)> {};
+template<>
+struct VectorAlignment<2> : std::integral_constant<std::size_t, 2 * sizeof(float)> {};
+template<>
+struct VectorAlignment<4> : std::integral_constant<std::size_t, 4 * sizeof(float)> {};
+
+template<std::size_t N>
+class alignas(VectorAlignment<N>::value) Vector {
+    std::array<float, N> elems{};
 public:
-    Vector() = default;
+    constexpr Vector() = default;
 
     template<typename... Args, vector_t<N, Args...>* = nullptr>
-    explicit Vector(Args... args) : elems{static_cast<float>(args)...} {}
+    constexpr explicit Vector(Args... args) : elems{static_cast<float>(args)...} {}
 
     // Addition
-    Vector<N> operator+(const Vector<N>& other) const {
+    constexpr Vector<N> operator+(const Vector<N>& other) const {
         Vector<N> result;
         for (std::size_t i = 0; i < N; ++i) {
             result.elems[i] = this->elems[i] + other.elems[i];
@@ -29,7 +40,7 @@ public:
     }
 
     // Subtraction
-    Vector<N> operator-(const Vector<N>& other) const {
+    constexpr Vector<N> operator-(const Vector<N>& other) const {
         Vector<N> result;
         for (std::size_t i = 0; i < N; ++i) {
             result.elems[i] = this->elems[i] - other.elems[i];
@@ -37,8 +48,16 @@ public:
         return result;
     }
 
+    constexpr Vector<N> operator-() const {
+        Vector<N> result;
+        for (std::size_t i = 0; i < N; ++i) {
+            result.elems[i] = -this->elems[i];
+        }
+        return result;
+    }
+
     // Dot Product
-    float operator*(const Vector<N>& other) const {
+    constexpr float operator*(const Vector<N>& other) const {
         float result = 0;
         for (std::size_t i = 0; i < N; ++i) {
             result += this->elems[i] * other.elems[i];
@@ -47,7 +66,7 @@ public:
     }
 
     // Scalar multiplication
-    Vector<N> operator*(float scalar) const {
+    constexpr Vector<N> operator*(float scalar) const {
         Vector<N> result;
         for (std::size_t i = 0; i < N; ++i) {
             result.elems[i] = this->elems[i] * scalar;
@@ -55,66 +74,95 @@ public:
         return result;
     }
 
-    bool operator<(const Vector<N>& other) const {
-        float a = 0;
-        float b = 0;
-        for (std::size_t i = 0; i < N; ++i) {
-            a += (this->elems[i] * this->elems[i]);
-            b += (other.elems[i] * other.elems[i]);
-        }
-        return sqrt(a) < sqrt(b);
+    constexpr Vector<N> operator/(float scalar) const {
+        return *this * (1.0f / scalar);
+    }
+
+    constexpr Vector<N>& operator+=(const Vector<N>& other) {
+        return *this = *this + other;
+    }
+
+    constexpr Vector<N>& operator-=(const Vector<N>& other) {
+        return *this = *this - other;
+    }
+
+    constexpr Vector<N>& operator*=(float scalar) {
+        return *this = *this * scalar;
+    }
+
+    // Squared length, for comparing lengths without a sqrt
+    constexpr float squaredNorm() const {
+        return *this * *this;
+    }
+
+    float length() const {
+        return std::sqrt(squaredNorm());
+    }
+
+    // Unit vector in the same direction, the zero vector stays zero
+    Vector<N> normalized() const {
+        float norm = length();
+        return norm > 0.0f ? *this / norm : *this;
+    }
+
+    void normalize() {
+        *this = normalized();
     }
 
-    bool operator>(const Vector<N>& other) const {
-        float a = 0;
-        float b = 0;
+    // Lexicographic order on the coordinates, so distinct points never compare equal.
+    // Compare squaredNorm() to order by length.
+    constexpr bool operator<(const Vector<N>& other) const {
         for (std::size_t i = 0; i < N; ++i) {
-            a += (this->elems[i] * this->elems[i]);
-            b += (other.elems[i] * other.elems[i]);
+            if (this->elems[i] != other.elems[i]) return this->elems[i] < other.elems[i];
         }
-        return sqrt(a) > sqrt(b);
+        return false;
     }
 
-    bool operator==(const Vector<N>& other) const {
+    constexpr bool operator>(const Vector<N>& other) const {
+        return other < *this;
+    }
+
+    constexpr bool operator==(const Vector<N>& other) const {
         for (std::size_t i = 0; i < N; ++i) {
             if (this->elems[i] != other.elems[i]) return false;
         }
         return true;
     }
 
-    // Indexing
-    float& operator[](std::size_t index) {
-        if (index >= N) {
-            throw std::out_of_range("Index out of bounds");
-        }
+    constexpr bool operator!=(const Vector<N>& other) const {
+        return !(*this == other);
+    }
+
+    // Indexing, bounds are only checked in debug builds
+    constexpr float& operator[](std::size_t index) {
+        assert(index < N && "Index out of bounds");
         return elems[index];
     }
 
-    const float& operator[](std::size_t index) const {
-        if (index >= N) {
-            throw std::out_of_range("Index out of bounds");
-        }
+    constexpr const float& operator[](std::size_t index) const {
+        assert(index < N && "Index out of bounds");
         return elems[index];
     }
 
-    // Access elements for hashing
-    const std::array<float, N>& get() const {
+    // Access all elements
+    constexpr const std::array<float, N>& get() const {
         return elems;
     }
 };
 
-// Specialize std::hash for Vector<N>
-namespace std {
-    template<std::size_t N>
-    struct hash<Vector<N>> {
-        size_t operator()(const Vector<N>& vec) const {
-            size_t seed = 0;
-            for (const auto& elem : vec.get()) {
-                seed ^= std::hash<float>{}(elem) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
-            }
-            return seed;
-        }
-    };
+template<std::size_t N>
+constexpr Vector<N> operator*(float scalar, const Vector<N>& vec) {
+    return vec * scalar;
+}
+
+template<std::size_t N>
+constexpr float squaredDistance(const Vector<N>& a, const Vector<N>& b) {
+    return (a - b).squaredNorm();
+}
+
+template<std::size_t N>
+float distance(const Vector<N>& a, const Vector<N>& b) {
+    return (a - b).length();
 }
 
 #endif // VECTOR_H
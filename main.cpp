@@ -1,8 +1,23 @@
 #include "SDLWindow.h"
+#include "Trace.h"
+#include <cstdlib>
 
-int main() {
-    SDLWindow sdlWindow("Test", 1200.0, 800.0);
-    sdlWindow.start();
+int main(int argc, char* argv[]) {
+    setTraceThreadName("main");
+    {
+        SDLWindow sdlWindow("Test", 1200.0, 800.0);
+        // Optional TSPLIB instance, random cities otherwise
+        if (argc > 1 && !sdlWindow.loadInstance(argv[1])) {
+            return 1;
+        }
+        sdlWindow.start();
+    }
+
+    // Phase timings are only recorded in builds with TSM_TRACING. The window, and with
+    // it the solver thread, is gone by now, so nothing records during the export.
+    if (const char* tracePath = std::getenv("TSM_TRACE")) {
+        writeChromeTrace(tracePath);
+    }
 
     return 0;
 }